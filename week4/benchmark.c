@@ -0,0 +1,73 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/time.h>
+#include "benchmark.h"
+
+/* The counting wrappers below call the real allocator. */
+#undef malloc
+#undef realloc
+
+static const char *phase_names[BENCH_PHASES] = {
+    "parsing", "evaluateRegexTreeRec", "convertNFAtoDFA", "saveNFA", "createOutputCode"
+};
+
+static double phase_start[BENCH_PHASES];
+static double phase_total[BENCH_PHASES];
+
+static unsigned long nfa_states_count = 0;
+static unsigned long dfa_states_count = 0;
+static unsigned long automata_count = 0;
+
+static unsigned long allocated_bytes = 0;
+static unsigned long allocations_count = 0;
+
+static double now() {
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+void benchmarkStart(int phase) {
+    phase_start[phase] = now();
+}
+
+void benchmarkStop(int phase) {
+    phase_total[phase] += now() - phase_start[phase];
+}
+
+void benchmarkCountStates(unsigned int nfa_states, unsigned int dfa_states) {
+    nfa_states_count += nfa_states;
+    dfa_states_count += dfa_states;
+    automata_count++;
+}
+
+// The regexes are evaluated from the parser actions, so that time is taken out of the parsing phase.
+void benchmarkReport(FILE *file) {
+    int phase;
+    double total = 0;
+
+    phase_total[BENCH_PARSE] -= phase_total[BENCH_EVALUATE];
+    for (phase = 0; phase < BENCH_PHASES; phase++) {
+        fprintf(file, "%-22s %10.3f ms\n", phase_names[phase], phase_total[phase] * 1000);
+        total += phase_total[phase];
+    }
+    fprintf(file, "%-22s %10.3f ms\n", "total", total * 1000);
+    fprintf(file, "%-22s %10lu\n", "automata", automata_count);
+    fprintf(file, "%-22s %10lu\n", "NFA states", nfa_states_count);
+    fprintf(file, "%-22s %10lu\n", "DFA states", dfa_states_count);
+    fprintf(file, "%-22s %10lu\n", "allocations", allocations_count);
+    fprintf(file, "%-22s %10lu\n", "bytes allocated", allocated_bytes);
+}
+
+void *benchmarkMalloc(size_t size) {
+    allocated_bytes += size;
+    allocations_count++;
+    return malloc(size);
+}
+
+// Counts the requested size; the old block is not subtracted, so the total is the allocation volume.
+void *benchmarkRealloc(void *ptr, size_t size) {
+    allocated_bytes += size;
+    allocations_count++;
+    return realloc(ptr, size);
+}
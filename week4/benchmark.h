@@ -0,0 +1,45 @@
+#ifndef benchmark_h
+#define benchmark_h
+
+/* Phase timers and allocation counters for the scanner generator benchmark.
+ * Everything compiles away unless BENCHMARK is defined; the benchmark build
+ * also force-includes this header (gcc -include) so that malloc and realloc
+ * are counted in every module. See the 'benchmark' target in the Makefile. */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#define BENCH_PARSE 0
+#define BENCH_EVALUATE 1
+#define BENCH_NFA_TO_DFA 2
+#define BENCH_SAVE 3
+#define BENCH_CODEGEN 4
+#define BENCH_PHASES 5
+
+#ifdef BENCHMARK
+
+void benchmarkStart(int phase);
+void benchmarkStop(int phase);
+void benchmarkCountStates(unsigned int nfa_states, unsigned int dfa_states);
+void benchmarkReport(FILE *file);
+void *benchmarkMalloc(size_t size);
+void *benchmarkRealloc(void *ptr, size_t size);
+
+#define BENCHMARK_START(phase) benchmarkStart(phase)
+#define BENCHMARK_STOP(phase) benchmarkStop(phase)
+#define BENCHMARK_COUNT_STATES(nfa_states, dfa_states) benchmarkCountStates(nfa_states, dfa_states)
+#define BENCHMARK_REPORT() benchmarkReport(stderr)
+
+#define malloc(size) benchmarkMalloc(size)
+#define realloc(ptr, size) benchmarkRealloc(ptr, size)
+
+#else
+
+#define BENCHMARK_START(phase)
+#define BENCHMARK_STOP(phase)
+#define BENCHMARK_COUNT_STATES(nfa_states, dfa_states)
+#define BENCHMARK_REPORT()
+
+#endif
+
+#endif /* benchmark_h */
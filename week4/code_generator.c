@@ -4,6 +4,7 @@
 #include <string.h>
 #include "code_generator.h"
 #include "scanner_specification.h"
+#include "benchmark.h"
 
 void addHeaders(FILE *file) {
     fprintf(file, "#include <stdio.h>\n");
@@ -12,6 +13,9 @@ void addHeaders(FILE *file) {
     fprintf(file, "#include \"nfa.h\"\n");
     fprintf(file, "#include \"intset.h\"\n");
     fprintf(file, "#include \"scanner_functions.h\"\n");
+    if (getOptionsSection().instrumentation_option == TRUE) {
+        fprintf(file, "#include <sys/time.h>\n");
+    }
 
     fprintf(file, "\n\n");
 }
@@ -25,6 +29,43 @@ void declareGlobalVariables(FILE *file) {
     fprintf(file, "void (*actions[%d]) (void); \n", getRegexTreeCount());
 }
 
+// Counters filled by the instrumented lexer, one slot per regex (the indices match the DFAs).
+void declareStatisticsVariables(FILE *file) {
+    fprintf(file, "unsigned long lexer_rule_matches[%d];\n", getRegexTreeCount()); // Times each rule won
+    fprintf(file, "unsigned long lexer_rule_bytes[%d];\n", getRegexTreeCount()); // Bytes consumed by each rule
+    fprintf(file, "unsigned long lexer_rule_dfa_steps[%d];\n", getRegexTreeCount()); // Transitions taken in each DFA
+    fprintf(file, "double lexer_rule_action_seconds[%d];\n", getRegexTreeCount()); // Time spent in each action
+    fprintf(file, "unsigned long lexer_fallback_bytes = 0;\n"); // Bytes echoed because no rule accepted
+}
+
+void declareDumpStatisticsFunction(FILE *file) {
+    fprintf(file, "void dumpLexerStatistics(FILE *file) {\n");
+    fprintf(file, "int i;\n");
+    fprintf(file, "const char *rule_tokens[%d] = {", getRegexTreeCount());
+    int i;
+    for (i=0; i<getRegexTreeCount(); i++) {
+        fprintf(file, "%s\"%s\"", i == 0 ? "" : ", ", getRegexTokens()[i]);
+    }
+    fprintf(file, "};\n");
+    fprintf(file, "const char *rule_actions[%d] = {", getRegexTreeCount());
+    for (i=0; i<getRegexTreeCount(); i++) {
+        fprintf(file, "%s\"%s\"", i == 0 ? "" : ", ", getRegexActions()[i]);
+    }
+    fprintf(file, "};\n");
+    fprintf(file, "fprintf(file, \"{\\\"rules\\\": [\");\n");
+    fprintf(file, "for (i = 0; i < dfa_count; i++) {\n");
+    fprintf(file, "fprintf(file, \"%%s\\n  {\\\"rule\\\": %%d, \\\"token\\\": \\\"%%s\\\", \\\"action\\\": \\\"%%s\\\", \", i == 0 ? \"\" : \",\", i, rule_tokens[i], rule_actions[i]);\n");
+    fprintf(file, "fprintf(file, \"\\\"matches\\\": %%lu, \\\"bytes\\\": %%lu, \\\"dfa_steps\\\": %%lu, \\\"action_seconds\\\": %%.6f}\", ");
+    fprintf(file, "lexer_rule_matches[i], lexer_rule_bytes[i], lexer_rule_dfa_steps[i], lexer_rule_action_seconds[i]);\n");
+    fprintf(file, "}\n");
+    fprintf(file, "fprintf(file, \"\\n ],\\n \\\"fallback_bytes\\\": %%lu\\n}\\n\", lexer_fallback_bytes);\n");
+    fprintf(file, "}\n");
+
+    fprintf(file, "void dumpLexerStatisticsAtExit() {\n");
+    fprintf(file, "dumpLexerStatistics(stderr);\n");
+    fprintf(file, "}\n");
+}
+
 void declareReadDFAsFunction(FILE *file) {
     fprintf(file, "void readDFAs() { \n");
     fprintf(file, "dfas = malloc(sizeof(dfa) * dfa_count);\n");
@@ -72,6 +113,7 @@ void declareFillActionsFunction(FILE *file) {
 }
 
 void declareLexerFunction(FILE *file){
+    int instrumented = getOptionsSection().instrumentation_option == TRUE;
     fprintf(file, "int %s(){ \n", getOptionsSection().lexer_routine);
     fprintf(file, "int *accepted_sizes = malloc(sizeof(int) * dfa_count);\n");
     fprintf(file, "while(input_buffer[0] != '\\");
@@ -84,13 +126,27 @@ void declareLexerFunction(FILE *file){
     fprintf(file, "int accepted_size = getGreatest(accepted_sizes, dfa_count, &dfa_index_accept);\n");
     fprintf(file, "if (accepted_size == 0) {\n");
     fprintf(file, "printf(\"%%c\", input_buffer[0]);\n");
+    if (instrumented) {
+        fprintf(file, "lexer_fallback_bytes++;\n");
+    }
     fprintf(file, "input_buffer = getNewInput(input_buffer, 1);\n");
     fprintf(file, "}\n");
     fprintf(file, "else {\n");
     fprintf(file, "char* accepted_string = getFirstNChars(accepted_size, input_buffer);\n");
     fprintf(file, "updateLexeme(accepted_size, accepted_string);\n");
     fprintf(file, "input_buffer = getNewInput(input_buffer, accepted_size);\n");
+    if (instrumented) {
+        fprintf(file, "lexer_rule_matches[dfa_index_accept]++;\n");
+        fprintf(file, "lexer_rule_bytes[dfa_index_accept] += accepted_size;\n");
+        fprintf(file, "struct timeval action_start, action_stop;\n");
+        fprintf(file, "gettimeofday(&action_start, NULL);\n");
+    }
     fprintf(file, "actions[dfa_index_accept]();\n"); // Call action function;
+    if (instrumented) {
+        fprintf(file, "gettimeofday(&action_stop, NULL);\n");
+        fprintf(file, "lexer_rule_action_seconds[dfa_index_accept] += (action_stop.tv_sec - action_start.tv_sec)");
+        fprintf(file, " + (action_stop.tv_usec - action_start.tv_usec) / 1e6;\n");
+    }
     fprintf(file, "if (tokens[dfa_index_accept] != -1) { \n");
     fprintf(file, "return tokens[dfa_index_accept];\n");
     fprintf(file, "}\n");
@@ -114,6 +170,7 @@ void declareGetFirstNCharsFunction(FILE *file){
     fprintf(file, "for (i = 0; i < n; i++){\n");
     fprintf(file, "new_string[i] = string[i];\n");
     fprintf(file, "}\n");
+    fprintf(file, "new_string[n] = '\\0';\n");
     fprintf(file, "return new_string;\n");
     fprintf(file, "}\n");
 }
@@ -128,6 +185,7 @@ void declareGetNewInputFunction(FILE *file){
     fprintf(file, "new_input[new_index] = input[i];\n");
     fprintf(file, "new_index++;\n");
     fprintf(file, "}\n");
+    fprintf(file, "new_input[new_index] = '\\0';\n");
     fprintf(file, "return new_input;\n");
     fprintf(file, "}\n");
 }
@@ -154,6 +212,9 @@ void declareGetSizeOfAcceptedInputFunction(FILE *file){
     fprintf(file, "int state = dfas[dfa_index].start;\n");
     fprintf(file, "for(string_index = 0; string_index < input_size; string_index++){\n");
     fprintf(file, "state = getNextState(dfa_index, state, input[string_index]);\n");
+    if (getOptionsSection().instrumentation_option == TRUE) {
+        fprintf(file, "lexer_rule_dfa_steps[dfa_index]++;\n");
+    }
     fprintf(file, "if(state == -1){ // The transition doesn't exist.\n");
     fprintf(file, "break;\n");
     fprintf(file, "}\n else{\n");
@@ -169,8 +230,9 @@ void declareGetSizeOfAcceptedInputFunction(FILE *file){
 }
 
 void declareGetNextStateFunction(FILE *file){
-    fprintf(file, "int getNextState(int dfa_index, int state, char symbol){\n");
-    fprintf(file, "intSet next_state_intset = copyIntSet(dfas[dfa_index].transition[state][(int)symbol]);\n");
+    // The symbol is taken as unsigned, so bytes from 128 on (UTF-8 input) index the table safely.
+    fprintf(file, "int getNextState(int dfa_index, int state, unsigned char symbol){\n");
+    fprintf(file, "intSet next_state_intset = copyIntSet(dfas[dfa_index].transition[state][symbol]);\n");
     fprintf(file, "if(isEmptyIntSet(next_state_intset)){\n");
     fprintf(file, "freeIntSet(next_state_intset);\n");
     fprintf(file, "return -1;\n");
@@ -189,14 +251,18 @@ void declareMain(FILE *file) {
     fprintf(file, "readDFAs();\n");
     fprintf(file, "fillActions();\n");
     fprintf(file, "fillTokens();\n");
-    fprintf(file, "while(1) { \n");
-    fprintf(file, "scanf(\"%%s\", input_buffer); \n");
+    if (getOptionsSection().instrumentation_option == TRUE) {
+        fprintf(file, "atexit(dumpLexerStatisticsAtExit);\n");
+    }
+    fprintf(file, "while(scanf(\"%%s\", input_buffer) == 1) { \n");
     fprintf(file, "%s();\n", getOptionsSection().lexer_routine);
     fprintf(file, "} \n");
+    fprintf(file, "return 0;\n");
     fprintf(file, "} \n");
 }
 
 void createOutputCode(char* filename){
+    BENCHMARK_START(BENCH_CODEGEN);
     FILE *file = fopen(filename, "w");
 
     if(! file){
@@ -206,6 +272,10 @@ void createOutputCode(char* filename){
 
     addHeaders(file);
     declareGlobalVariables(file);
+    if (getOptionsSection().instrumentation_option == TRUE) {
+        declareStatisticsVariables(file);
+        declareDumpStatisticsFunction(file);
+    }
     declareReadDFAsFunction(file);
     declareNoActionFunction(file);
     declareFillTokensFunction(file);
@@ -220,4 +290,5 @@ void createOutputCode(char* filename){
     declareMain(file);
 
     fclose(file);
+    BENCHMARK_STOP(BENCH_CODEGEN);
 }
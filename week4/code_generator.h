@@ -6,6 +6,8 @@
 
 void addHeaders(FILE *file);
 void declareGlobalVariables(FILE *file);
+void declareStatisticsVariables(FILE *file);
+void declareDumpStatisticsFunction(FILE *file);
 void declareReadDFAsFunction(FILE *file);
 void declareFillTokensFunction(FILE *file);
 void declareFillActionsFunction(FILE *file);
@@ -4,6 +4,7 @@
 #include <stdlib.h>
 #include "scanner_specification.h"
 #include "code_generator.h"
+#include "benchmark.h"
 
 extern char *yytext;
 extern int line;
@@ -18,7 +19,8 @@ extern int line;
         TOKEN_DEF, NO_TOKEN_DEF, ACTION_DEF, NO_ACTION_DEF, REGEXP_EOF, REGEXP_ANYCHAR,
         REGEXP_DEF, TOKEN_EPSILON, OPEN_PARENTHESIS, CLOSE_PARENTHESIS, OPEN_CURLYBRACES,
         CLOSE_CURLYBRACES, OPEN_BRACES, CLOSE_BRACES, IDENTIFIER, LITERAL_INT, LITERAL_CHAR,
-        RANGE_INT, RANGE_CHAR, OPERAND, BINARYOP, UNARYOP;
+        RANGE_INT, RANGE_CHAR, LITERAL_CODEPOINT, RANGE_CODEPOINT, OPERAND, BINARYOP, UNARYOP,
+        INSTRUMENTATION_OPTION_ON, INSTRUMENTATION_OPTION_OFF;
 %options "generate-lexer-wrapper";
 %lexical yylex;
 
@@ -29,7 +31,7 @@ Input                   : SpecificationFile
 SpecificationFile       :
                             [BEGIN_SECTION_OPTIONS OptionsSection END_SECTION_OPTIONS SEMICOLON]?
                             [BEGIN_SECTION_DEFINES {initializeDefinitionsSection();} DefinesSection END_SECTION_DEFINES SEMICOLON]?
-                            [BEGIN_SECTION_REGEXPS {initializeRegexTrees();} RegExpsSection END_SECTION_REGEXPS SEMICOLON { convertAndSaveDFAs(); createOutputCode("scanner.c"); exit(EXIT_SUCCESS);}]
+                            [BEGIN_SECTION_REGEXPS {initializeRegexTrees();} RegExpsSection END_SECTION_REGEXPS SEMICOLON { BENCHMARK_STOP(BENCH_PARSE); convertAndSaveDFAs(); createOutputCode("scanner.c"); BENCHMARK_REPORT(); exit(EXIT_SUCCESS);}]
                         ;
 
 OptionsSection          :
@@ -40,6 +42,8 @@ OptionsSection          :
                                                 POSITIONING_COLUMN IDENTIFIER {setPositioningColumneName(yytext);} SEMICOLON] |
                              [POSITIONING_OPTION_OFF {setPositioningOption(FALSE);} SEMICOLON]]?
                             [DEFAULT_ACTION_OPTION IDENTIFIER {setDefaultActionRoutineName(yytext);} SEMICOLON]?
+                            [[INSTRUMENTATION_OPTION_ON {setInstrumentationOption(TRUE);} SEMICOLON] |
+                             [INSTRUMENTATION_OPTION_OFF {setInstrumentationOption(FALSE);} SEMICOLON]]?
                         ;
 
 DefinesSection
@@ -48,44 +52,48 @@ DefinesSection
                                     [LITERAL_INT {addLiteralToDefinition(identifier, yytext);}
                                     |LITERAL_CHAR {addLiteralToDefinition(identifier, yytext);}
                                     |RANGE_INT {addRangeToDefinition(identifier, yytext);}
-                                    |RANGE_CHAR {addRangeToDefinition(identifier, yytext);}]
+                                    |RANGE_CHAR {addRangeToDefinition(identifier, yytext);}
+                                    |LITERAL_CODEPOINT {addCodePointToDefinition(identifier, yytext);}
+                                    |RANGE_CODEPOINT {addCodePointRangeToDefinition(identifier, yytext);}]
                                     [COMMA[LITERAL_INT {addLiteralToDefinition(identifier, yytext);}
                                     |LITERAL_CHAR {addLiteralToDefinition(identifier, yytext);}
                                     |RANGE_INT {addRangeToDefinition(identifier, yytext);}
-                                    |RANGE_CHAR {addRangeToDefinition(identifier, yytext);}]]*
+                                    |RANGE_CHAR {addRangeToDefinition(identifier, yytext);}
+                                    |LITERAL_CODEPOINT {addCodePointToDefinition(identifier, yytext);}
+                                    |RANGE_CODEPOINT {addCodePointRangeToDefinition(identifier, yytext);}]]*
                                 CLOSE_BRACES SEMICOLON]* {free(identifier);}
                             ;
 
 RegExpsSection
-{   RegexTree *r; }     :
+{   RegexTree r; }     :
                             [REGEXP_DEF [RegularExpressionSet | { r = regexTreeCreateEOFTree(); evaluateRegexTree(r); addTreeToArray(r); } REGEXP_EOF | { r = regexTreeCreateAnycharTree(); evaluateRegexTree(r); addTreeToArray(r); } REGEXP_ANYCHAR] SEMICOLON
                              [[TOKEN_DEF IDENTIFIER { addToken(yytext); } SEMICOLON] | [NO_TOKEN_DEF { addNoToken(); } SEMICOLON]]
                              { addDefaultAction(); }[[ACTION_DEF IDENTIFIER { addAction(yytext); } SEMICOLON] | [NO_ACTION_DEF { addNoAction(); } SEMICOLON]]?]+
                         ;
 
 RegularExpressionSet
-{   RegexTree *rSet;
-    RegexTree *new_regex_ptr;
-    RegexTree *r;
-    RegexTree *tree_ptr; }  :
+{   RegexTree rSet;
+    RegexTree new_regex_ptr;
+    RegexTree r;
+    RegexTree tree_ptr; }  :
                                 { r = makeNewRegexTree(); tree_ptr = r; } [RegularExpression(tree_ptr)] { evaluateRegexTree(r); addTreeToArray(r); }
                             |   [OPEN_CURLYBRACES { rSet = makeNewRegexSetTree(); new_regex_ptr = addRegexToRegexSetTree(rSet); } RegularExpression(new_regex_ptr)
                                     [SEMICOLON { new_regex_ptr = addRegexToRegexSetTree(rSet); } RegularExpression(new_regex_ptr)]* CLOSE_CURLYBRACES { evaluateRegexTree(rSet); addTreeToArray(rSet); }]
                             ;
 
-RegularExpression(RegexTree *node)
-{ RegexTree *child; int operation_type; }   :
+RegularExpression(RegexTree node)
+{ RegexTree child; int operation_type; }   :
                                                 { child = regexTreeAddTerm(node); } Term(child)
                                                 [BINARYOP { operation_type = parseOperationsToType(yytext); regexTreeAddBinary(node, operation_type); } { child = regexTreeAddTerm(node); } Term(child)]*
                                             ;
 
-Term(RegexTree *node)
-{ RegexTree *child; int operation_type; }   :
+Term(RegexTree node)
+{ RegexTree child; int operation_type; }   :
                                                 { child = regexTreeAddFactor(node); } Factor(child) [UNARYOP { operation_type = parseOperationsToType(yytext); regexTreeAddUnary(node, operation_type); }]?
                                             ;
 
-Factor(RegexTree *node)
-{ RegexTree *child; }   :
+Factor(RegexTree node)
+{ RegexTree child; }   :
                             [OPERAND | LITERAL_CHAR | LITERAL_INT | IDENTIFIER | TOKEN_EPSILON] { regexTreeAddValue(node, yytext); }
                         |   OPEN_PARENTHESIS { child = regexTreeAddRegex(node);} RegularExpression(child) CLOSE_PARENTHESIS
                         ;
@@ -101,6 +109,7 @@ void LLmessage(int token) {
 }
 
 int main() {
+    BENCHMARK_START(BENCH_PARSE);
     LLparser();
     return 0;
 }
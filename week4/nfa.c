@@ -27,7 +27,7 @@ nfa makeNFA(int nstates) {
     n.final = makeEmptyIntSet();
     n.transition = safeMalloc(nstates*sizeof(intSet *));
     for (s=0; s < nstates; s++) {
-        n.transition[s] = safeMalloc(129*sizeof(intSet));
+        n.transition[s] = safeMalloc((EPSILON+1)*sizeof(intSet));
         for (c=0; c <= EPSILON; c++) {
             n.transition[s][c] = makeEmptyIntSet();
         }
@@ -41,7 +41,7 @@ void reallocateNfaStates(nfa *n, int new_nstates) {
 
     int s, c;
     for (s=old_nstates; s<new_nstates; s++) {
-        n->transition[s] = safeMalloc(129*sizeof(intSet));
+        n->transition[s] = safeMalloc((EPSILON+1)*sizeof(intSet));
         for (c=0; c<=EPSILON; c++) {
             n->transition[s][c] = makeEmptyIntSet();
         }
@@ -49,6 +49,177 @@ void reallocateNfaStates(nfa *n, int new_nstates) {
     n->nstates = new_nstates;
 }
 
+nfa copyNFA(nfa n) {
+    nfa cp = makeNFA(n.nstates);
+    unsigned int s, c;
+    cp.start = n.start;
+    unionIntSet(&cp.final, n.final);
+    for (s=0; s < n.nstates; s++) {
+        for (c=0; c <= EPSILON; c++) {
+            unionIntSet(&cp.transition[s][c], n.transition[s][c]);
+        }
+    }
+    return cp;
+}
+
+/* Building blocks for makeSymbolSetNFA(). A code point range is split into runs whose UTF-8
+ * encodings all have the same length and differ only in a byte range per position; every run
+ * then becomes a chain of states from the start state to the final state. The chains are built
+ * from the last byte backwards and a state is identified by (byte range, next state), so runs
+ * that end in the same continuation bytes share their suffix states. */
+typedef struct utf8Edge {
+    unsigned int from, to;
+    unsigned char low, high;
+} utf8Edge;
+
+typedef struct utf8Builder {
+    unsigned int state_count;   /* intermediate states, numbered 1..state_count */
+    unsigned int edge_count;
+    unsigned int allocated_edges;
+    utf8Edge *edges;
+} utf8Builder;
+
+#define UTF8_START 0
+#define UTF8_FINAL 0xFFFFFFFFu
+
+static void addUtf8Edge(utf8Builder *b, unsigned int from, unsigned char low, unsigned char high, unsigned int to) {
+    if (b->edge_count == b->allocated_edges) {
+        b->allocated_edges = (b->allocated_edges == 0 ? 16 : 2 * b->allocated_edges);
+        b->edges = realloc(b->edges, b->allocated_edges * sizeof(utf8Edge));
+    }
+    b->edges[b->edge_count].from = from;
+    b->edges[b->edge_count].to = to;
+    b->edges[b->edge_count].low = low;
+    b->edges[b->edge_count].high = high;
+    b->edge_count++;
+}
+
+// Returns the state that reads one byte in [low, high] and moves to next, creating it if needed.
+static unsigned int utf8SuffixState(utf8Builder *b, unsigned char low, unsigned char high, unsigned int next) {
+    unsigned int i;
+    for (i = 0; i < b->edge_count; i++) {
+        utf8Edge e = b->edges[i];
+        if (e.from != UTF8_START && e.low == low && e.high == high && e.to == next) {
+            return e.from;
+        }
+    }
+    b->state_count++;
+    addUtf8Edge(b, b->state_count, low, high, next);
+    return b->state_count;
+}
+
+static unsigned int encodeUtf8(unsigned int codepoint, unsigned char *bytes) {
+    if (codepoint < 0x80) {
+        bytes[0] = codepoint;
+        return 1;
+    }
+    if (codepoint < 0x800) {
+        bytes[0] = 0xC0 | (codepoint >> 6);
+        bytes[1] = 0x80 | (codepoint & 0x3F);
+        return 2;
+    }
+    if (codepoint < 0x10000) {
+        bytes[0] = 0xE0 | (codepoint >> 12);
+        bytes[1] = 0x80 | ((codepoint >> 6) & 0x3F);
+        bytes[2] = 0x80 | (codepoint & 0x3F);
+        return 3;
+    }
+    bytes[0] = 0xF0 | (codepoint >> 18);
+    bytes[1] = 0x80 | ((codepoint >> 12) & 0x3F);
+    bytes[2] = 0x80 | ((codepoint >> 6) & 0x3F);
+    bytes[3] = 0x80 | (codepoint & 0x3F);
+    return 4;
+}
+
+static void addUtf8Range(utf8Builder *b, unsigned int low, unsigned int high) {
+    static const unsigned int length_limits[] = { 0x7F, 0x7FF, 0xFFFF };
+    unsigned int i;
+
+    if (low > high) {
+        return;
+    }
+    // Surrogates are not valid code points and have no UTF-8 encoding.
+    if (low < 0xD800 && high >= 0xD800) {
+        addUtf8Range(b, low, 0xD7FF);
+        addUtf8Range(b, 0xE000, high);
+        return;
+    }
+    if (low >= 0xD800 && low <= 0xDFFF) {
+        addUtf8Range(b, 0xE000, high);
+        return;
+    }
+    // Split where the length of the encoding changes.
+    for (i = 0; i < 3; i++) {
+        if (low <= length_limits[i] && high > length_limits[i]) {
+            addUtf8Range(b, low, length_limits[i]);
+            addUtf8Range(b, length_limits[i] + 1, high);
+            return;
+        }
+    }
+    // Split until every continuation byte position covers either one value or a whole block.
+    for (i = 1; i < 4; i++) {
+        unsigned int m = (1u << (6*i)) - 1;
+        if ((low & ~m) != (high & ~m)) {
+            if ((low & m) != 0) {
+                addUtf8Range(b, low, low | m);
+                addUtf8Range(b, (low | m) + 1, high);
+                return;
+            }
+            if ((high & m) != m) {
+                addUtf8Range(b, low, (high & ~m) - 1);
+                addUtf8Range(b, high & ~m, high);
+                return;
+            }
+        }
+    }
+
+    unsigned char low_bytes[4], high_bytes[4];
+    unsigned int length = encodeUtf8(low, low_bytes);
+    encodeUtf8(high, high_bytes);
+
+    unsigned int next = UTF8_FINAL;
+    for (i = length - 1; i > 0; i--) {
+        next = utf8SuffixState(b, low_bytes[i], high_bytes[i], next);
+    }
+    addUtf8Edge(b, UTF8_START, low_bytes[0], high_bytes[0], next);
+}
+
+// Creates an NFA that accepts one byte of the given set, or the UTF-8 encoding of one code point
+// in the given ranges (pairs of inclusive bounds). The start state is 0 and the single final state
+// is the last one, as the combinators below expect.
+nfa makeSymbolSetNFA(intSet symbols, unsigned int *codepoint_ranges, unsigned int range_count) {
+    utf8Builder b;
+    unsigned int i, symbol;
+
+    b.state_count = 0;
+    b.edge_count = 0;
+    b.allocated_edges = 0;
+    b.edges = NULL;
+    for (i = 0; i < range_count; i++) {
+        unsigned int high = codepoint_ranges[2*i+1];
+        addUtf8Range(&b, codepoint_ranges[2*i], (high > MAX_CODEPOINT ? MAX_CODEPOINT : high));
+    }
+
+    unsigned int final_state = b.state_count + 1;
+    nfa n = makeNFA(final_state + 1);
+    n.start = 0;
+    for (symbol = 0; symbol <= EPSILON; symbol++) {
+        if (isMemberIntSet(symbol, symbols)) {
+            insertIntSet(final_state, &n.transition[0][symbol]);
+        }
+    }
+    for (i = 0; i < b.edge_count; i++) {
+        unsigned int to = (b.edges[i].to == UTF8_FINAL ? final_state : b.edges[i].to);
+        for (symbol = b.edges[i].low; symbol <= b.edges[i].high; symbol++) {
+            insertIntSet(to, &n.transition[b.edges[i].from][symbol]);
+        }
+    }
+    insertIntSet(final_state, &n.final);
+
+    free(b.edges);
+    return n;
+}
+
 void freeNFA(nfa n) {
     unsigned int s, c;
     freeIntSet(n.final);
@@ -99,6 +270,10 @@ nfa readNFA(char *filename) {
                 fprintf(stderr, "Syntax error in automata file   %c\n", c);
                 exit(EXIT_FAILURE);
         }
+        if (state >= nstates || c < 0 || c > EPSILON) {
+            fprintf(stderr, "Syntax error in automata file: transition out of range\n");
+            exit(EXIT_FAILURE);
+        }
         n.transition[state][c] = readIntSetFromFile(f);
     }
     fclose(f);
@@ -123,7 +298,7 @@ void saveNFA(char *filename, nfa n) {
                 if (c == EPSILON) {
                     fprintf(f, "eps ");
                 } else {
-                    if (c > ' ') {
+                    if (c > ' ' && c < 127) {
                         fprintf(f, "'%c' ", c);
                     } else {
                         fprintf(f, "#%d ", c);
@@ -157,25 +332,32 @@ intSet epsilonClosure(int state, nfa n) {
     return closure;
 }
 
+// Worklist over the epsilon transitions; every state is expanded once, so cycles of epsilon
+// transitions (nested closures) terminate.
 intSet epsilonStarClosure(int state, nfa n) {
-    intSet current_state_closure = epsilonClosure(state, n);
-    intSet current_state_closure_copy = copyIntSet(current_state_closure);
-
-    while (!isEmptyIntSet(current_state_closure_copy)) {
-        unsigned int state_to_expand = chooseFromIntSet(current_state_closure_copy);
-        deleteIntSet(state_to_expand, &current_state_closure_copy);
-
-        if (state_to_expand != state) {
-            unionIntSet(&current_state_closure, epsilonStarClosure(state_to_expand, n));
+    intSet closure = makeEmptyIntSet();
+    intSet to_expand = makeEmptyIntSet();
+    insertIntSet(state, &closure);
+    insertIntSet(state, &to_expand);
+
+    while (!isEmptyIntSet(to_expand)) {
+        unsigned int state_to_expand = chooseFromIntSet(to_expand);
+        deleteIntSet(state_to_expand, &to_expand);
+
+        intSet reachable = epsilonClosure(state_to_expand, n);
+        while (!isEmptyIntSet(reachable)) {
+            unsigned int reached = chooseFromIntSet(reachable);
+            deleteIntSet(reached, &reachable);
+            if (!isMemberIntSet(reached, closure)) {
+                insertIntSet(reached, &closure);
+                insertIntSet(reached, &to_expand);
+            }
         }
+        freeIntSet(reachable);
     }
+    freeIntSet(to_expand);
 
-    // Add the state itself in the intSet.
-    if (! isMemberIntSet(state, current_state_closure)) {
-        insertIntSet(state, &current_state_closure);
-    }
-
-    return current_state_closure;
+    return closure;
 }
 
 intSet epsilonStarClosureSet(intSet states, nfa n) {
@@ -316,12 +498,12 @@ void processDfaString(char *string, dfa d) {
     int last_accepted_index = -1;
     unsigned int current_state = d.start;
     for (string_index = 0; string_index < string_size; string_index++) {
-        char c = string[string_index];
+        unsigned char c = string[string_index];
         if (isEmptyIntSet(d.transition[current_state][c])) {
             break;
         }
         else {
-            current_state = chooseFromIntSet(d.transition[current_state][string[string_index]]);
+            current_state = chooseFromIntSet(d.transition[current_state][c]);
             if (isMemberIntSet(current_state, d.final)) {
                 last_accepted_index = string_index;
             }
@@ -421,7 +603,7 @@ nfa concatenateNFAs(nfa nfa1, nfa nfa2){
     intSet transitionsToMerge = makeEmptyIntSet();
     int symbol;
     int last_nfa1_state = i - 1;
-    for (symbol = 0; symbol < 129; symbol++){
+    for (symbol = 0; symbol <= EPSILON; symbol++){
         intSet nfa2_copy_set = copyIntSet(nfa2.transition[nfa2.start][symbol]);
 
         while (! isEmptyIntSet(nfa2_copy_set)) {
@@ -438,7 +620,7 @@ nfa concatenateNFAs(nfa nfa1, nfa nfa2){
     // Copy the remaining transitions to the new NFA.
     int s;
     for (s = 1; s < nfa2.nstates; s++){
-        for (symbol = 0; symbol < 129; symbol++) {
+        for (symbol = 0; symbol <= EPSILON; symbol++) {
             if (! isEmptyIntSet(nfa2.transition[s][symbol])){
                 intSet transitions = addToAllIntSetItems(last_nfa1_state, nfa2.transition[s][symbol]);
                 concatenated_nfa.transition[i][symbol] = copyIntSet(transitions);
@@ -470,7 +652,7 @@ nfa kleeneClosureNFA(nfa nfa){
     // Copy transitions
     int i, symbol;
     for (i = 0; i < nfa.nstates; i++){
-        for (symbol = 0; symbol < 129; symbol++) {
+        for (symbol = 0; symbol <= EPSILON; symbol++) {
             if (! isEmptyIntSet(nfa.transition[i][symbol])){
                 intSet transitions = addToAllIntSetItems(1, nfa.transition[i][symbol]);
                 new_nfa.transition[new_nfa_index][symbol] = copyIntSet(transitions);
@@ -516,7 +698,7 @@ nfa optionalOperationNFA(nfa nfa){
     // Copy transitions
     int i, symbol;
     for (i = 0; i < nfa.nstates; i++){
-        for (symbol = 0; symbol < 129; symbol++) {
+        for (symbol = 0; symbol <= EPSILON; symbol++) {
             if (! isEmptyIntSet(nfa.transition[i][symbol])){
                 intSet transitions = addToAllIntSetItems(1, nfa.transition[i][symbol]);
                 new_nfa.transition[new_nfa_index][symbol] = copyIntSet(transitions);
@@ -555,7 +737,7 @@ nfa positiveClosureNFA(nfa nfa){
     // Copy transitions
     int i, symbol;
     for (i = 0; i < nfa.nstates; i++){
-        for (symbol = 0; symbol < 129; symbol++) {
+        for (symbol = 0; symbol <= EPSILON; symbol++) {
             if (! isEmptyIntSet(nfa.transition[i][symbol])){
                 intSet transitions = addToAllIntSetItems(1, nfa.transition[i][symbol]);
                 new_nfa.transition[new_nfa_index][symbol] = copyIntSet(transitions);
@@ -2,8 +2,12 @@
 #define NFA_H
 #include "intset.h"
 
-/* Do not change EPSILON! There are 128 ASCII characters. */
-#define EPSILON 128
+/* The automata work on bytes, so the input alphabet has 256 symbols. Epsilon is
+ * kept in an extra transition slot after the last byte, where no input symbol can
+ * reach it. Code points beyond ASCII are matched through their UTF-8 encoding. */
+#define ALPHABET_SIZE 256
+#define EPSILON ALPHABET_SIZE
+#define MAX_CODEPOINT 0x10FFFF
 typedef struct nfa {
     unsigned int nstates;  /* number of states                          */
     unsigned int start;    /* number of thestart state                  */
@@ -16,6 +20,8 @@ typedef nfa dfa;
 static void *safeMalloc(unsigned int sz);
 nfa makeNFA(int nstates);
 void reallocateNfaStates(nfa *n, int new_nstates);
+nfa copyNFA(nfa n);
+nfa makeSymbolSetNFA(intSet symbols, unsigned int *codepoint_ranges, unsigned int range_count);
 void freeNFA(nfa n);
 nfa readNFA(char *filename);
 void saveNFA(char *filename, nfa n);
@@ -3,11 +3,31 @@
 #include <stdio.h>
 #include "nfa.h"
 #include "scanner_specification.h"
+#include "benchmark.h"
 
 static ScannerOptions options_section;
 
 static ScannerDefinition *definitions_section;
 
+// Fragment NFAs for single symbols and for the anychar wildcard. They are built the first time
+// they are needed and then shared by every regex that refers to the same value.
+static nfa symbol_fragments[EPSILON+1];
+static int symbol_fragment_built[EPSILON+1];
+static nfa anychar_fragment;
+static int anychar_fragment_built = FALSE;
+static unsigned int *codepoint_fragment_codepoints = NULL;
+static nfa *codepoint_fragments = NULL;
+static unsigned int codepoint_fragment_count = 0;
+
+// All the nodes of all the regex trees live in a single arena and refer to each other by index.
+// The NFAs of the value nodes and of the evaluated roots are kept out of line, in regex_nfas.
+static RegexNode *regex_arena;
+static unsigned int regex_arena_size = 0;
+static unsigned int regex_arena_allocated_size = 0;
+static nfa *regex_nfas;
+static unsigned int regex_nfas_size = 0;
+static unsigned int regex_nfas_allocated_size = 0;
+
 static unsigned int regex_trees_count = 0;
 static RegexTree *regex_trees;
 static nfa *nfa_array;
@@ -29,6 +49,7 @@ void initializeScannerOptions(){
     options_section.positioning_line_name = NULL;
     options_section.positioning_column_name = NULL;
     options_section.default_action_routine = "defaultAction";
+    options_section.instrumentation_option = FALSE;
 }
 
 void setLexerRoutine(char *routine_name){
@@ -65,6 +86,10 @@ void setDefaultActionRoutineName(char *routine_name){
     strcpy(options_section.default_action_routine, routine_name);
 }
 
+void setInstrumentationOption(int option){
+    options_section.instrumentation_option = option;
+}
+
 void printOptions(){
     printf("Lexer routine: %s\n", options_section.lexer_routine);
     printf("Lexeme name: %s\n", options_section.lexeme_name);
@@ -76,6 +101,7 @@ void printOptions(){
     }
 
     printf("Default action routine: %s\n", options_section.default_action_routine);
+    printf("Instrumentation option: %d\n", options_section.instrumentation_option);
 }
 
 void initializeDefinitionsSection() {
@@ -102,73 +128,97 @@ ScannerDefinition* searchDefinition(char *name) {
     return NULL;
 }
 
-void addLiteralToDefinition (char *name, char *literal) {
-    char literal_to_add = literal[1];
-
+// Returns the definition with the given name, creating an empty one if it does not exist yet.
+static ScannerDefinition* searchOrAddDefinition(char *name) {
     ScannerDefinition *definition_ptr = searchDefinition(name);
-    if (definition_ptr == NULL) {
-        if (definitions_section == NULL) {
-            definitions_section = malloc(sizeof(ScannerDefinition));
-            definition_ptr = definitions_section;
-        }
-        else {
-            definition_ptr = definitions_section;
-            while (definition_ptr->next != NULL) {
-                definition_ptr = definition_ptr->next;
-            }
-            definition_ptr->next = malloc(sizeof(ScannerDefinition));
-            definition_ptr = definition_ptr->next;
-        }
-        definition_ptr->definition_name = malloc(sizeof(char) * (strlen(name)+1));
-        strcpy(definition_ptr->definition_name, name);
-        definition_ptr->definition_expansion = makeEmptyIntSet();
-        insertIntSet((unsigned int)literal_to_add, &definition_ptr->definition_expansion);
-        definition_ptr->next = NULL;
+    if (definition_ptr != NULL) {
+        return definition_ptr;
+    }
+
+    if (definitions_section == NULL) {
+        definitions_section = malloc(sizeof(ScannerDefinition));
+        definition_ptr = definitions_section;
     }
     else {
-        insertIntSet((unsigned int)literal_to_add, &definition_ptr->definition_expansion);
+        definition_ptr = definitions_section;
+        while (definition_ptr->next != NULL) {
+            definition_ptr = definition_ptr->next;
+        }
+        definition_ptr->next = malloc(sizeof(ScannerDefinition));
+        definition_ptr = definition_ptr->next;
     }
+    definition_ptr->definition_name = malloc(sizeof(char) * (strlen(name)+1));
+    strcpy(definition_ptr->definition_name, name);
+    definition_ptr->definition_expansion = makeEmptyIntSet();
+    definition_ptr->codepoint_ranges = NULL;
+    definition_ptr->codepoint_range_count = 0;
+    definition_ptr->definition_nfa_built = FALSE;
+    definition_ptr->next = NULL;
+
+    return definition_ptr;
+}
+
+void addLiteralToDefinition (char *name, char *literal) {
+    unsigned char literal_to_add = literal[1];
+
+    ScannerDefinition *definition_ptr = searchOrAddDefinition(name);
+    insertIntSet((unsigned int)literal_to_add, &definition_ptr->definition_expansion);
 }
 
 void addRangeToDefinition (char *name, char *range) {
-    char range_low = range[1];
-    char range_high = range[5];
+    unsigned char range_low = range[1];
+    unsigned char range_high = range[5];
     if (range_low > range_high) {
         fprintf(stderr, "Error: definition of a range with lower bound greater than higher bound.\n");
         exit(EXIT_FAILURE);
     }
 
-    ScannerDefinition *definition_ptr = searchDefinition(name);
-    if (definition_ptr == NULL) {
-        if (definitions_section == NULL) {
-            definitions_section = malloc(sizeof(ScannerDefinition));
-            definition_ptr = definitions_section;
-        }
-        else {
-            definition_ptr = definitions_section;
-            while (definition_ptr->next != NULL) {
-                definition_ptr = definition_ptr->next;
-            }
-            definition_ptr->next = malloc(sizeof(ScannerDefinition));
-            definition_ptr = definition_ptr->next;
-        }
-        definition_ptr->definition_name = malloc(sizeof(char) * (strlen(name)+1));
-        strcpy(definition_ptr->definition_name, name);
-        definition_ptr->definition_expansion = makeEmptyIntSet();
-        int i;
-        for (i=(int)range_low; i <= range_high; i++) {
-            insertIntSet((unsigned int)i, &definition_ptr->definition_expansion);
-        }
-        definition_ptr->next = NULL;
+    ScannerDefinition *definition_ptr = searchOrAddDefinition(name);
+    unsigned int i;
+    for (i=range_low; i <= range_high; i++) {
+        insertIntSet(i, &definition_ptr->definition_expansion);
     }
-    else {
-        int i;
-        for (i=(int)range_low; i <= range_high; i++) {
-            insertIntSet((unsigned int)i, &definition_ptr->definition_expansion);
-        }
+}
+
+static void addCodePointsToDefinition (char *name, unsigned int low, unsigned int high) {
+    if (low > high) {
+        fprintf(stderr, "Error: definition of a range with lower bound greater than higher bound.\n");
+        exit(EXIT_FAILURE);
+    }
+    if (high > MAX_CODEPOINT) {
+        fprintf(stderr, "Error: code point U+%X is out of the Unicode range.\n", high);
+        exit(EXIT_FAILURE);
+    }
+
+    ScannerDefinition *definition_ptr = searchOrAddDefinition(name);
+    // ASCII code points are single bytes, the rest is compiled to UTF-8 by makeSymbolSetNFA().
+    while (low < 0x80 && low <= high) {
+        insertIntSet(low, &definition_ptr->definition_expansion);
+        low++;
+    }
+    if (low <= high) {
+        unsigned int count = definition_ptr->codepoint_range_count;
+        definition_ptr->codepoint_ranges = realloc(definition_ptr->codepoint_ranges, sizeof(unsigned int) * 2 * (count+1));
+        definition_ptr->codepoint_ranges[2*count] = low;
+        definition_ptr->codepoint_ranges[2*count+1] = high;
+        definition_ptr->codepoint_range_count++;
     }
 }
 
+// literal has the form U+XXXX
+void addCodePointToDefinition (char *name, char *literal) {
+    unsigned int codepoint = (unsigned int)strtoul(&literal[2], NULL, 16);
+    addCodePointsToDefinition(name, codepoint, codepoint);
+}
+
+// range has the form U+XXXX-U+YYYY
+void addCodePointRangeToDefinition (char *name, char *range) {
+    char *high_str = strchr(range, '-');
+    unsigned int low = (unsigned int)strtoul(&range[2], NULL, 16);
+    unsigned int high = (unsigned int)strtoul(&high_str[3], NULL, 16);
+    addCodePointsToDefinition(name, low, high);
+}
+
 void printDefinitions() {
     if (definitions_section == NULL) {
         printf("There are no definitions!\n");
@@ -178,6 +228,10 @@ void printDefinitions() {
         while (definition_ptr != NULL) {
             printf("Definition name: %s.\n", definition_ptr->definition_name);
             printf("Definition expansion: "); printlnIntSet(definition_ptr->definition_expansion);
+            unsigned int i;
+            for (i = 0; i < definition_ptr->codepoint_range_count; i++) {
+                printf("Code points: U+%04X-U+%04X\n", definition_ptr->codepoint_ranges[2*i], definition_ptr->codepoint_ranges[2*i+1]);
+            }
             definition_ptr = definition_ptr->next;
         }
 
@@ -210,217 +264,253 @@ void initializeRegexTrees() {
     regex_trees = malloc(sizeof(RegexTree) * regex_trees_count);
     regex_tokens = malloc(sizeof(char*) * regex_trees_count);
     regex_actions = malloc(sizeof(char*) * regex_trees_count);
+
+    regex_arena_size = 0;
+    regex_arena_allocated_size = 0;
+    regex_arena = NULL;
+    regex_nfas_size = 0;
+    regex_nfas_allocated_size = 0;
+    regex_nfas = NULL;
 }
 
-RegexTree* makeNewRegexTree() {
-    RegexTree *tree = malloc(sizeof(RegexTree));
-    tree->parent = NULL;
-    tree->node_type = TYPE_REGEX;
-    tree->children_count = 0;
-    tree->children = NULL;
+RegexNode* getRegexNode(RegexTree tree) {
+    if (tree >= regex_arena_size) {
+        fprintf(stderr, "Error: regex node index %u out of bounds.\n", tree);
+        exit(EXIT_FAILURE);
+    }
+    return &regex_arena[tree];
+}
 
-    return tree;
+// Stores an NFA in the out of line NFA array, returns its index.
+static unsigned int storeRegexNFA(nfa regex_nfa) {
+    if (regex_nfas_size == regex_nfas_allocated_size) {
+        regex_nfas_allocated_size = (regex_nfas_allocated_size == 0 ? 16 : 2 * regex_nfas_allocated_size);
+        regex_nfas = realloc(regex_nfas, sizeof(nfa) * regex_nfas_allocated_size);
+    }
+    regex_nfas[regex_nfas_size] = regex_nfa;
+    regex_nfas_size++;
+
+    return regex_nfas_size - 1;
+}
+
+// Takes a fresh node from the arena. The arena may be moved by realloc(), so callers must hold
+// on to the returned index and not to a RegexNode pointer.
+static RegexTree allocateRegexNode() {
+    if (regex_arena_size == regex_arena_allocated_size) {
+        regex_arena_allocated_size = (regex_arena_allocated_size == 0 ? 64 : 2 * regex_arena_allocated_size);
+        regex_arena = realloc(regex_arena, sizeof(RegexNode) * regex_arena_allocated_size);
+    }
+    regex_arena_size++;
+
+    return regex_arena_size - 1;
+}
+
+RegexTree makeNewRegexTree() {
+    return makeRegexTreeNode(TYPE_REGEX);
 }
 
 // This function is used when a set of regexes are provided. The idea is to consider all the regexes
 // in the set as a single RegexTree, with the union operator between the regexes.
-RegexTree* makeNewRegexSetTree() {
-    RegexTree *tree = makeNewRegexTree();
+RegexTree makeNewRegexSetTree() {
+    RegexTree tree = makeNewRegexTree();
 
     return tree;
 }
-RegexTree* addRegexToRegexSetTree(RegexTree *tree_root) {
-    RegexTree *new_regex;
+RegexTree addRegexToRegexSetTree(RegexTree tree_root) {
+    RegexTree new_regex;
 
-    if (tree_root->children_count == 0) {
+    if (getRegexNode(tree_root)->children_count == 0) {
         // This is the first regex to be added - do not add the union operator
-        RegexTree *term = regexTreeAddTerm(tree_root);
-        RegexTree *factor = regexTreeAddFactor(term);
+        RegexTree term = regexTreeAddTerm(tree_root);
+        RegexTree factor = regexTreeAddFactor(term);
         new_regex = regexTreeAddRegex(factor);
     }
     else {
         // There are already other regexes in this tree. First add a union operator, then the new regex.
         regexTreeAddBinary(tree_root, BINARYOP_UNION);
 
-        RegexTree *term = regexTreeAddTerm(tree_root);
-        RegexTree *factor = regexTreeAddFactor(term);
+        RegexTree term = regexTreeAddTerm(tree_root);
+        RegexTree factor = regexTreeAddFactor(term);
         new_regex = regexTreeAddRegex(factor);
     }
 
     return new_regex;
 }
 
-void makeRegexTreeNode(RegexTree *dest, int node_type) {
+RegexTree makeRegexTreeNode(int node_type) {
     if (node_type == TYPE_VALUE) {
         fprintf(stderr, "Error: trying to add a value node with makeRegexTreeNode().\n");
         exit(EXIT_FAILURE);
     }
-    dest->parent = NULL;
-    dest->node_type = node_type;
-    dest->children_count = 0;
-    dest->children = NULL;
+    RegexTree tree = allocateRegexNode();
+    RegexNode *node = getRegexNode(tree);
+    node->parent = REGEX_NO_NODE;
+    node->node_type = node_type;
+    node->nfa_index = REGEX_NO_NFA;
+    node->children_count = 0;
+    node->first_child = REGEX_NO_NODE;
+    node->last_child = REGEX_NO_NODE;
+    node->next_sibling = REGEX_NO_NODE;
+
+    return tree;
 }
 
-void makeRegexTreeValueNode(RegexTree *dest, nfa regex_nfa) {
-    dest->parent = NULL;
-    dest->node_type = TYPE_VALUE;
-    dest->regex_nfa = regex_nfa;
-    dest->children_count = 0;
-    dest->children = NULL;
+RegexTree makeRegexTreeValueNode(nfa regex_nfa) {
+    RegexTree tree = allocateRegexNode();
+    RegexNode *node = getRegexNode(tree);
+    node->parent = REGEX_NO_NODE;
+    node->node_type = TYPE_VALUE;
+    node->nfa_index = storeRegexNFA(regex_nfa);
+    node->children_count = 0;
+    node->first_child = REGEX_NO_NODE;
+    node->last_child = REGEX_NO_NODE;
+    node->next_sibling = REGEX_NO_NODE;
+
+    return tree;
 }
 
-// Return a pointer to the new child node
-RegexTree *regexTreeAddTerm (RegexTree *node_to_add) {
-    if (node_to_add->node_type != TYPE_REGEX) {
-        fprintf(stderr, "Error: trying do add a term to a non-regex node. Node type: %d\n", node_to_add->node_type);
-        exit(EXIT_FAILURE);
-    }
+// Links child as the last child of parent, in constant time.
+static RegexTree appendRegexChild(RegexTree parent, RegexTree child) {
+    RegexNode *parent_node = getRegexNode(parent);
 
-    unsigned int new_children_index = node_to_add->children_count;
-    node_to_add->children = realloc(node_to_add->children, sizeof(RegexTree) * (node_to_add->children_count+1));
-    makeRegexTreeNode(&node_to_add->children[new_children_index], TYPE_TERM);
-    node_to_add->children[new_children_index].parent = node_to_add;
-    node_to_add->children_count++;
+    getRegexNode(child)->parent = parent;
+    if (parent_node->last_child == REGEX_NO_NODE) {
+        parent_node->first_child = child;
+    }
+    else {
+        getRegexNode(parent_node->last_child)->next_sibling = child;
+    }
+    parent_node->last_child = child;
+    parent_node->children_count++;
 
-    return &node_to_add->children[new_children_index];
+    return child;
 }
 
-// Return a pointer to the new child node
-RegexTree *regexTreeAddFactor (RegexTree *node_to_add) {
-    if (node_to_add->node_type != TYPE_TERM) {
-        fprintf(stderr, "Error: trying do add a factor to a non-term node. Node type: %d\n", node_to_add->node_type);
+// Return the index of the new child node
+RegexTree regexTreeAddTerm (RegexTree node_to_add) {
+    if (getRegexNode(node_to_add)->node_type != TYPE_REGEX) {
+        fprintf(stderr, "Error: trying do add a term to a non-regex node. Node type: %d\n", getRegexNode(node_to_add)->node_type);
         exit(EXIT_FAILURE);
     }
 
-    unsigned int new_children_index = node_to_add->children_count;
-    node_to_add->children = realloc(node_to_add->children, sizeof(RegexTree) * (node_to_add->children_count+1));
-    makeRegexTreeNode(&node_to_add->children[new_children_index], TYPE_FACTOR);
-    node_to_add->children[new_children_index].parent = node_to_add;
-    node_to_add->children_count++;
+    return appendRegexChild(node_to_add, makeRegexTreeNode(TYPE_TERM));
+}
+
+// Return the index of the new child node
+RegexTree regexTreeAddFactor (RegexTree node_to_add) {
+    if (getRegexNode(node_to_add)->node_type != TYPE_TERM) {
+        fprintf(stderr, "Error: trying do add a factor to a non-term node. Node type: %d\n", getRegexNode(node_to_add)->node_type);
+        exit(EXIT_FAILURE);
+    }
 
-    return &node_to_add->children[new_children_index];
+    return appendRegexChild(node_to_add, makeRegexTreeNode(TYPE_FACTOR));
 }
 
-// Return a pointer to the new child node
-RegexTree *regexTreeAddValue (RegexTree *node_to_add, char *regex_value) {
-    if (node_to_add->node_type != TYPE_FACTOR) {
-        fprintf(stderr, "Error: trying do add a value to a non-factor node. Node type: %d\n", node_to_add->node_type);
+// Return the index of the new child node
+RegexTree regexTreeAddValue (RegexTree node_to_add, char *regex_value) {
+    if (getRegexNode(node_to_add)->node_type != TYPE_FACTOR) {
+        fprintf(stderr, "Error: trying do add a value to a non-factor node. Node type: %d\n", getRegexNode(node_to_add)->node_type);
         exit(EXIT_FAILURE);
     }
 
-    unsigned int new_children_index = node_to_add->children_count;
-    node_to_add->children = realloc(node_to_add->children, sizeof(RegexTree) * (node_to_add->children_count+1));
     nfa regex_nfa = regexpToNFA(regex_value);
-    makeRegexTreeValueNode(&node_to_add->children[new_children_index], regex_nfa);
-    node_to_add->children[new_children_index].parent = node_to_add;
-    node_to_add->children_count++;
-
-    return &node_to_add->children[new_children_index];
+    return appendRegexChild(node_to_add, makeRegexTreeValueNode(regex_nfa));
 }
 
-// Return a pointer to the new child node
-RegexTree *regexTreeAddRegex (RegexTree *node_to_add) {
-    if (node_to_add->node_type != TYPE_FACTOR) {
-        fprintf(stderr, "Error: trying do add a regex to a non-factor node. Node type: %d\n", node_to_add->node_type);
+// Return the index of the new child node
+RegexTree regexTreeAddRegex (RegexTree node_to_add) {
+    if (getRegexNode(node_to_add)->node_type != TYPE_FACTOR) {
+        fprintf(stderr, "Error: trying do add a regex to a non-factor node. Node type: %d\n", getRegexNode(node_to_add)->node_type);
         exit(EXIT_FAILURE);
     }
 
-    unsigned int new_children_index = node_to_add->children_count;
-    node_to_add->children = realloc(node_to_add->children, sizeof(RegexTree) * (node_to_add->children_count+1));
-    makeRegexTreeNode(&node_to_add->children[new_children_index], TYPE_REGEX);
-    node_to_add->children[new_children_index].parent = node_to_add;
-    node_to_add->children_count++;
-
-    return &node_to_add->children[new_children_index];
+    return appendRegexChild(node_to_add, makeRegexTreeNode(TYPE_REGEX));
 }
 
-RegexTree* regexTreeAddBinary (RegexTree *node_to_add, int binary_op) {
-    if (node_to_add->node_type != TYPE_REGEX) {
+RegexTree regexTreeAddBinary (RegexTree node_to_add, int binary_op) {
+    if (getRegexNode(node_to_add)->node_type != TYPE_REGEX) {
         fprintf(stderr, "Error: trying to add a binary operation to a non-regex node.\n");
         exit(EXIT_FAILURE);
     }
 
-    unsigned int new_children_index = node_to_add->children_count;
-    node_to_add->children = realloc(node_to_add->children, sizeof(RegexTree) * (node_to_add->children_count+1));
-    makeRegexTreeNode(&node_to_add->children[new_children_index], binary_op);
-    node_to_add->children[new_children_index].parent = node_to_add;
-    node_to_add->children_count++;
-
-    return &node_to_add->children[new_children_index];
+    return appendRegexChild(node_to_add, makeRegexTreeNode(binary_op));
 }
 
-RegexTree* regexTreeAddUnary (RegexTree *node_to_add, int unary_op){
-    if (node_to_add->node_type != TYPE_TERM) {
+RegexTree regexTreeAddUnary (RegexTree node_to_add, int unary_op){
+    if (getRegexNode(node_to_add)->node_type != TYPE_TERM) {
         fprintf(stderr, "Error: trying to add a binary operation to a non-term node.\n");
         exit(EXIT_FAILURE);
     }
 
-    unsigned int new_children_index = node_to_add->children_count;
-    node_to_add->children = realloc(node_to_add->children, sizeof(RegexTree) * (node_to_add->children_count+1));
-    makeRegexTreeNode(&node_to_add->children[new_children_index], unary_op);
-    node_to_add->children[new_children_index].parent = node_to_add;
-    node_to_add->children_count++;
-
-    return &node_to_add->children[new_children_index];
+    return appendRegexChild(node_to_add, makeRegexTreeNode(unary_op));
 }
 
-RegexTree* regexTreeCreateEOFTree() {
-    RegexTree *tree = makeNewRegexTree();
-    RegexTree *term = regexTreeAddTerm(tree);
-    RegexTree *factor = regexTreeAddFactor(term);
-    RegexTree *value = regexTreeAddValue(factor, "eof");
+RegexTree regexTreeCreateEOFTree() {
+    RegexTree tree = makeNewRegexTree();
+    RegexTree term = regexTreeAddTerm(tree);
+    RegexTree factor = regexTreeAddFactor(term);
+    regexTreeAddValue(factor, "eof");
 
     return tree;
 }
 
-RegexTree* regexTreeCreateAnycharTree() {
-    RegexTree *tree = makeNewRegexTree();
-    RegexTree *term = regexTreeAddTerm(tree);
-    RegexTree *factor = regexTreeAddFactor(term);
-    RegexTree *value = regexTreeAddValue(factor, "anychar");
+RegexTree regexTreeCreateAnycharTree() {
+    RegexTree tree = makeNewRegexTree();
+    RegexTree term = regexTreeAddTerm(tree);
+    RegexTree factor = regexTreeAddFactor(term);
+    regexTreeAddValue(factor, "anychar");
 
     return tree;
 }
 
-void evaluateRegexTree(RegexTree *root) {
-    evaluateRegexTreeRec(root);
+// Only the NFA of the root is kept; the NFAs of the inner nodes are intermediate results.
+void evaluateRegexTree(RegexTree root) {
+    BENCHMARK_START(BENCH_EVALUATE);
+    nfa root_nfa = evaluateRegexTreeRec(root);
+    BENCHMARK_STOP(BENCH_EVALUATE);
+    getRegexNode(root)->nfa_index = storeRegexNFA(root_nfa);
 }
 
-nfa evaluateRegexTreeRec(RegexTree *tree) {
+nfa evaluateRegexTreeRec(RegexTree tree) {
     nfa final_nfa;
-    switch(tree->node_type) {
+    RegexTree child, operation;
+    unsigned int node_type = getRegexNode(tree)->node_type;
+
+    switch(node_type) {
         case TYPE_REGEX:
-            final_nfa = evaluateRegexTreeRec(&tree->children[0]);
-            int children_index = 0;
-            while (children_index < (tree->children_count-1)) {
+            child = getRegexNode(tree)->first_child;
+            final_nfa = evaluateRegexTreeRec(child);
+            operation = getRegexNode(child)->next_sibling;
+            while (operation != REGEX_NO_NODE) {
+                child = getRegexNode(operation)->next_sibling;
                 // Switch the binary operation
-                switch(tree->children[children_index+1].node_type) {
+                switch(getRegexNode(operation)->node_type) {
                     case BINARYOP_UNION:
-                        final_nfa = uniteNFAs(final_nfa, evaluateRegexTreeRec(&tree->children[children_index+2]));
+                        final_nfa = uniteNFAs(final_nfa, evaluateRegexTreeRec(child));
                         break;
                     case BINARYOP_CONCATENATION:
-                        final_nfa = concatenateNFAs(final_nfa, evaluateRegexTreeRec(&tree->children[children_index+2]));
+                        final_nfa = concatenateNFAs(final_nfa, evaluateRegexTreeRec(child));
                         break;
                     default:
                         fprintf(stderr, "Error in evaluateRegexTreeRec.\n");
                         exit(EXIT_FAILURE);
                 }
-                children_index += 2;
+                operation = getRegexNode(child)->next_sibling;
             }
-
-            tree->regex_nfa = final_nfa;
             break;
         case TYPE_TERM:
-            if (tree->children_count > 1) {
-                switch(tree->children[1].node_type) {
+            child = getRegexNode(tree)->first_child;
+            operation = getRegexNode(child)->next_sibling;
+            if (operation != REGEX_NO_NODE) {
+                switch(getRegexNode(operation)->node_type) {
                     case UNARYOP_OPTIONAL:
-                        tree->regex_nfa = optionalOperationNFA(evaluateRegexTreeRec(&tree->children[0]));
+                        final_nfa = optionalOperationNFA(evaluateRegexTreeRec(child));
                         break;
                     case UNARYOP_KLEENECLOSURE:
-                        tree->regex_nfa = kleeneClosureNFA(evaluateRegexTreeRec(&tree->children[0]));
+                        final_nfa = kleeneClosureNFA(evaluateRegexTreeRec(child));
                         break;
                     case UNARYOP_POSITIVECLOSURE:
-                        tree->regex_nfa = positiveClosureNFA(evaluateRegexTreeRec(&tree->children[0]));
+                        final_nfa = positiveClosureNFA(evaluateRegexTreeRec(child));
                         break;
                     default:
                         fprintf(stderr, "Error in evaluateRegexTreeRec.\n");
@@ -428,28 +518,29 @@ nfa evaluateRegexTreeRec(RegexTree *tree) {
                 }
             }
             else {
-                tree->regex_nfa = evaluateRegexTreeRec(&tree->children[0]);
+                final_nfa = evaluateRegexTreeRec(child);
             }
             break;
         case TYPE_FACTOR:
-            tree->regex_nfa = evaluateRegexTreeRec(&tree->children[0]);
+            final_nfa = evaluateRegexTreeRec(getRegexNode(tree)->first_child);
             break;
         case TYPE_VALUE:
             // Do nothing, just return the NFA.
+            final_nfa = regex_nfas[getRegexNode(tree)->nfa_index];
             break;
         default:
             fprintf(stderr, "Error in evaluateRegexTreeRec.\n");
             exit(EXIT_FAILURE);
     }
 
-    return tree->regex_nfa;
+    return final_nfa;
 }
 
 // Add a tree to the array, returns the index of the new tree.
-unsigned int addTreeToArray (RegexTree *tree_to_add) {
+unsigned int addTreeToArray (RegexTree tree_to_add) {
     unsigned int new_tree_index = regex_trees_count;
     regex_trees = realloc(regex_trees, sizeof(RegexTree) * (regex_trees_count+1));
-    regex_trees[new_tree_index] = *tree_to_add;
+    regex_trees[new_tree_index] = tree_to_add;
     regex_trees_count++;
 
     return new_tree_index;
@@ -506,59 +597,112 @@ void convertAndSaveDFAs() {
 
     int i;
     for(i=0; i<regex_trees_count; i++) {
-        nfa_array[i] = regex_trees[i].regex_nfa;
+        nfa_array[i] = getRegexTreeNFA(regex_trees[i]);
+        BENCHMARK_START(BENCH_NFA_TO_DFA);
         dfa_array[i] = convertNFAtoDFA(nfa_array[i]);
+        BENCHMARK_STOP(BENCH_NFA_TO_DFA);
+        BENCHMARK_COUNT_STATES(nfa_array[i].nstates, dfa_array[i].nstates);
         sprintf(filename, "dfa%d.dfa", i);
+        BENCHMARK_START(BENCH_SAVE);
         saveNFA(filename, dfa_array[i]);
+        BENCHMARK_STOP(BENCH_SAVE);
     }
 }
 
-// Given a regexp LITERAL_CHAR, LITERAL_INT or an ASCII value, creates its correspondent NFA.
-nfa regexpToNFA(char* regexp){
-    nfa nfa = makeNFA(2);
-    nfa.start = 0;
+// The NFAs returned by the functions below are shared fragments: several regex trees may hold the
+// same transition table. The NFA combinators never modify their operands, so a fragment can be
+// passed to them directly; anything that wants to change it in place has to copyNFA() it first.
+nfa symbolToNFA(unsigned int symbol) {
+    if (!symbol_fragment_built[symbol]) {
+        intSet symbols = makeEmptyIntSet();
+        insertIntSet(symbol, &symbols);
+        symbol_fragments[symbol] = makeSymbolSetNFA(symbols, NULL, 0);
+        symbol_fragment_built[symbol] = TRUE;
+        freeIntSet(symbols);
+    }
+    return symbol_fragments[symbol];
+}
+
+nfa anycharToNFA() {
+    if (!anychar_fragment_built) {
+        // Any ASCII byte or the UTF-8 encoding of any other code point.
+        intSet symbols = makeEmptyIntSet();
+        unsigned int i;
+        unsigned int non_ascii[2] = { 0x80, MAX_CODEPOINT };
+        for (i = 0; i < 0x80; i++) {
+            insertIntSet(i, &symbols);
+        }
+        anychar_fragment = makeSymbolSetNFA(symbols, non_ascii, 1);
+        anychar_fragment_built = TRUE;
+        freeIntSet(symbols);
+    }
+    return anychar_fragment;
+}
+
+// A spec names few code points above ASCII, so their fragments are found by a linear search.
+nfa codepointToNFA(unsigned int codepoint) {
+    unsigned int i;
+    for (i = 0; i < codepoint_fragment_count; i++) {
+        if (codepoint_fragment_codepoints[i] == codepoint) {
+            return codepoint_fragments[i];
+        }
+    }
+    unsigned int range[2] = { codepoint, codepoint };
+    intSet no_bytes = makeEmptyIntSet();
+    codepoint_fragment_codepoints = realloc(codepoint_fragment_codepoints, sizeof(unsigned int) * (codepoint_fragment_count+1));
+    codepoint_fragments = realloc(codepoint_fragments, sizeof(nfa) * (codepoint_fragment_count+1));
+    codepoint_fragment_codepoints[codepoint_fragment_count] = codepoint;
+    codepoint_fragments[codepoint_fragment_count] = makeSymbolSetNFA(no_bytes, range, 1);
+    freeIntSet(no_bytes);
+    return codepoint_fragments[codepoint_fragment_count++];
+}
+
+// The definitions section is complete before the first regex is parsed, so the fragment of a
+// definition can be built once and reused for every occurrence of its name.
+nfa definitionToNFA(ScannerDefinition *definition) {
+    if (!definition->definition_nfa_built) {
+        definition->definition_nfa = makeSymbolSetNFA(definition->definition_expansion,
+                                                      definition->codepoint_ranges,
+                                                      definition->codepoint_range_count);
+        definition->definition_nfa_built = TRUE;
+    }
+    return definition->definition_nfa;
+}
 
-    // Add a transition with the given symbol from the start state to the final state 1.
+// Given a regexp LITERAL_CHAR, LITERAL_INT or a code point, returns its correspondent NFA.
+// Code points from 128 on are matched by their UTF-8 encoding.
+nfa regexpToNFA(char* regexp){
     if(regexp[0] == '\''){
-        insertIntSet(1, &nfa.transition[0][(int)regexp[1]]);
+        return symbolToNFA((unsigned char)regexp[1]);
     }
     else if(regexp[0] == '#'){
         char* symb = strtok(regexp, "#");
-        int symbol = atoi(symb);
-        insertIntSet(1, &nfa.transition[0][symbol]);
+        unsigned long codepoint = strtoul(symb, NULL, 10);
+        if (codepoint < 0x80) {
+            return symbolToNFA((unsigned int)codepoint);
+        }
+        if (codepoint > MAX_CODEPOINT) {
+            fprintf(stderr, "Error on regexpToNFA: code point %lu is out of the Unicode range.\n", codepoint);
+            exit(EXIT_FAILURE);
+        }
+        return codepointToNFA((unsigned int)codepoint);
     }else if(strcmp(regexp, "eof") == 0){
         // EOF ASCII symbol is 0
-        insertIntSet(1, &nfa.transition[0][0]);
+        return symbolToNFA(0);
     }else if(strcmp(regexp, "anychar") == 0){
-        int i;
-        for (i = 0; i <= 127; i++){
-            insertIntSet(1, &nfa.transition[0][i]);
-        }
+        return anycharToNFA();
     }else if(strcmp(regexp, "epsilon") == 0){
-        insertIntSet(1, &nfa.transition[0][128]);
+        return symbolToNFA(EPSILON);
     }else {
         ScannerDefinition *definition;
         definition = searchDefinition(regexp);
 
-        if (definition != NULL){
-            intSet expansion_copy = copyIntSet(definition->definition_expansion);
-            // Add a transition for each symbol that the definition represents.
-            while (! isEmptyIntSet(expansion_copy)) {
-                int symbol = chooseFromIntSet(expansion_copy);
-                deleteIntSet(symbol, &expansion_copy);
-                insertIntSet(1, &nfa.transition[0][symbol]);
-            }
-        }
-        else{
+        if (definition == NULL){
             fprintf(stderr, "Error on regexpToNFA: definition \'%s\' not found.\n", regexp);
             exit(EXIT_FAILURE);
         }
+        return definitionToNFA(definition);
     }
-    intSet final_state = makeEmptyIntSet();
-    insertIntSet(1, &final_state);
-    nfa.final = copyIntSet(final_state);
-
-    return nfa;
 }
 
 ScannerOptions getOptionsSection() {
@@ -569,6 +713,15 @@ RegexTree *getRexexTrees() {
     return regex_trees;
 }
 
+nfa getRegexTreeNFA(RegexTree tree) {
+    unsigned int nfa_index = getRegexNode(tree)->nfa_index;
+    if (nfa_index == REGEX_NO_NFA) {
+        fprintf(stderr, "Error: regex tree %u has not been evaluated.\n", tree);
+        exit(EXIT_FAILURE);
+    }
+    return regex_nfas[nfa_index];
+}
+
 unsigned int getRegexTreeCount() {
     return regex_trees_count;
 }
@@ -27,21 +27,34 @@ typedef struct ScannerOptions{
     char *positioning_line_name;
     char *positioning_column_name;
     char *default_action_routine;
+    int instrumentation_option;
 }ScannerOptions;
 
 typedef struct ScannerDefinition {
     char *definition_name;
-    intSet definition_expansion;
+    intSet definition_expansion;       /* single bytes */
+    unsigned int *codepoint_ranges;    /* pairs of inclusive bounds, matched as UTF-8 */
+    unsigned int codepoint_range_count;
+    nfa definition_nfa;           /* fragment built on first use, see definitionToNFA() */
+    int definition_nfa_built;
     struct ScannerDefinition *next;
 } ScannerDefinition;
 
-typedef struct RegexTree {
-    struct RegexTree *parent;
+#define REGEX_NO_NODE 0xFFFFFFFFu
+#define REGEX_NO_NFA 0xFFFFFFFFu
+
+// A regex tree is referred to by the index of its root node in the node arena.
+typedef unsigned int RegexTree;
+
+typedef struct RegexNode {
+    RegexTree parent;
     unsigned int node_type;
-    nfa regex_nfa;
+    unsigned int nfa_index;     /* index in the NFA array, REGEX_NO_NFA if there is none */
     unsigned int children_count;
-    struct RegexTree *children;
-} RegexTree;
+    RegexTree first_child;
+    RegexTree last_child;
+    RegexTree next_sibling;
+} RegexNode;
 
 void initializeScannerOptions();
 void setLexerRoutine(char *routine_name);
@@ -50,6 +63,7 @@ void setPositioningOption(int option);
 void setPositioningLineName (char *name);
 void setPositioningColumneName (char *name);
 void setDefaultActionRoutineName(char *routine_name);
+void setInstrumentationOption(int option);
 void printOptions();
 
 void initializeDefinitionsSection();
@@ -57,38 +71,46 @@ void mallocStrCpy(char *dest, char *src);
 ScannerDefinition* searchDefinition(char *name);
 void addLiteralToDefinition(char *name, char *literal);
 void addRangeToDefinition(char *name, char *range);
+void addCodePointToDefinition(char *name, char *literal);
+void addCodePointRangeToDefinition(char *name, char *range);
 void printDefinitions();
 
 int parseOperationsToType (char *lexeme);
 void initializeRegexTrees();
-RegexTree* makeNewRegexTree();
-RegexTree* makeNewRegexSetTree();
-RegexTree* addRegexToRegexSetTree(RegexTree *tree_root);
-void makeRegexTreeNode(RegexTree *dest, int node_type);
-void makeRegexTreeValueNode(RegexTree *dest, nfa regex_nfa);
-RegexTree *regexTreeAddTerm (RegexTree *node_to_add);
-RegexTree *regexTreeAddFactor (RegexTree *node_to_add);
-RegexTree *regexTreeAddValue (RegexTree *node_to_add, char *regex_value);
-RegexTree *regexTreeAddRegex (RegexTree *node_to_add);
-RegexTree* regexTreeAddBinary (RegexTree *node_to_add, int binary_op);
-RegexTree* regexTreeAddUnary (RegexTree *node_to_add, int unary_op);
-RegexTree* regexTreeCreateEOFTree();
-RegexTree* regexTreeCreateAnycharTree();
-void evaluateRegexTree(RegexTree *root);
-nfa evaluateRegexTreeRec(RegexTree *tree);
-unsigned int addTreeToArray (RegexTree *tree_to_add);
+RegexNode* getRegexNode(RegexTree tree);
+RegexTree makeNewRegexTree();
+RegexTree makeNewRegexSetTree();
+RegexTree addRegexToRegexSetTree(RegexTree tree_root);
+RegexTree makeRegexTreeNode(int node_type);
+RegexTree makeRegexTreeValueNode(nfa regex_nfa);
+RegexTree regexTreeAddTerm (RegexTree node_to_add);
+RegexTree regexTreeAddFactor (RegexTree node_to_add);
+RegexTree regexTreeAddValue (RegexTree node_to_add, char *regex_value);
+RegexTree regexTreeAddRegex (RegexTree node_to_add);
+RegexTree regexTreeAddBinary (RegexTree node_to_add, int binary_op);
+RegexTree regexTreeAddUnary (RegexTree node_to_add, int unary_op);
+RegexTree regexTreeCreateEOFTree();
+RegexTree regexTreeCreateAnycharTree();
+void evaluateRegexTree(RegexTree root);
+nfa evaluateRegexTreeRec(RegexTree tree);
+unsigned int addTreeToArray (RegexTree tree_to_add);
 void addToken(char *lexeme);
 void addNoToken();
 void addDefaultAction();
 void addAction(char *lexeme);
 void addNoAction();
 
+nfa symbolToNFA(unsigned int symbol);
+nfa anycharToNFA();
+nfa codepointToNFA(unsigned int codepoint);
+nfa definitionToNFA(ScannerDefinition *definition);
 nfa regexpToNFA(char* regexp);
 void convertAndSaveDFAs();
 void printTokensAndActions();
 
 ScannerOptions getOptionsSection();
 RegexTree* getRexexTrees();
+nfa getRegexTreeNFA(RegexTree tree);
 unsigned int getRegexTreeCount();
 char **getRegexTokens();
 char **getRegexActions();
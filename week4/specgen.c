@@ -0,0 +1,171 @@
+/* Generates a synthetic scanner specification and a matching input file for the
+ * scanner generator benchmark (see the 'benchmark' target in the Makefile).
+ *
+ * usage: specgen <keyword rules> <class rules> <closure rules> <input bytes> <spec.lex> <input.txt>
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#define MAX_KEYWORD_LENGTH 8
+
+static unsigned long random_state = 12345;
+
+// Small LCG, so that the generated files are the same on every platform.
+static unsigned int nextRandom(unsigned int bound) {
+    random_state = random_state * 6364136223846793005UL + 1442695040888963407UL;
+    return (unsigned int)((random_state >> 33) % bound);
+}
+
+static char randomLetter() {
+    return 'a' + nextRandom(26);
+}
+
+static void makeKeyword(char *keyword) {
+    int length = 3 + nextRandom(MAX_KEYWORD_LENGTH - 2);
+    int i;
+    for (i = 0; i < length; i++) {
+        keyword[i] = randomLetter();
+    }
+    keyword[length] = '\0';
+}
+
+// Identifiers in a specification are letters only, so class i is named class + i in base 26.
+static void className(int index, char *name) {
+    char digits[8];
+    int count = 0, i;
+    do {
+        digits[count++] = 'a' + index % 26;
+        index /= 26;
+    } while (index > 0);
+    sprintf(name, "class");
+    for (i = 0; i < count; i++) {
+        name[5+i] = digits[count-1-i];
+    }
+    name[5+count] = '\0';
+}
+
+static void writeOptions(FILE *spec) {
+    fprintf(spec, "section options\n");
+    fprintf(spec, "  lexer yylex;\n");
+    fprintf(spec, "  lexeme yytext;\n");
+    fprintf(spec, "  positioning off;\n");
+    fprintf(spec, "  default action defaultAction;\n");
+    fprintf(spec, "end section options;\n\n");
+}
+
+// Every class definition is two letter ranges and one extra letter.
+static void writeDefinitions(FILE *spec, int class_count) {
+    int i;
+    char name[16];
+    fprintf(spec, "section defines\n");
+    fprintf(spec, "  define digit = ['0'-'9'];\n");
+    for (i = 0; i < class_count; i++) {
+        char low1 = 'a' + nextRandom(13), low2 = 'A' + nextRandom(13);
+        className(i, name);
+        fprintf(spec, "  define %s = ['%c'-'%c', '%c'-'%c', '%c'];\n", name,
+                low1, low1 + 1 + nextRandom(12), low2, low2 + 1 + nextRandom(12), randomLetter());
+    }
+    fprintf(spec, "end section defines;\n\n");
+}
+
+static void writeRuleTail(FILE *spec) {
+    fprintf(spec, "    no token;\n");
+    fprintf(spec, "    no action;\n");
+}
+
+static void writeRules(FILE *spec, char keywords[][MAX_KEYWORD_LENGTH+1], int keyword_count,
+                       int class_count, int closure_count) {
+    int i, j;
+    char name1[16], name2[16], name3[16];
+    fprintf(spec, "section regexps\n");
+    for (i = 0; i < keyword_count; i++) {
+        fprintf(spec, "  regexp ");
+        for (j = 0; keywords[i][j] != '\0'; j++) {
+            fprintf(spec, "%s'%c'", (j == 0 ? "" : "."), keywords[i][j]);
+        }
+        fprintf(spec, ";\n");
+        writeRuleTail(spec);
+    }
+    for (i = 0; i < class_count; i++) {
+        className(i, name1);
+        className(nextRandom(class_count), name2);
+        className(nextRandom(class_count), name3);
+        fprintf(spec, "  regexp %s.(%s|%s|digit)*;\n", name1, name2, name3);
+        writeRuleTail(spec);
+    }
+    for (i = 0; i < closure_count; i++) {
+        char c = randomLetter();
+        if (class_count > 0) {
+            className(nextRandom(class_count), name1);
+            className(nextRandom(class_count), name2);
+            fprintf(spec, "  regexp (('%c'|%s)+.(%s.digit?)*)*.'%c';\n", c, name1, name2, randomLetter());
+        }
+        else {
+            fprintf(spec, "  regexp (('%c'|digit)+.('%c'.digit?)*)*.'%c';\n", c, randomLetter(), randomLetter());
+        }
+        writeRuleTail(spec);
+    }
+    fprintf(spec, "  regexp eof;\n");
+    writeRuleTail(spec);
+    fprintf(spec, "end section regexps;\n");
+}
+
+// Words are keywords, identifiers and numbers; ten words per line.
+static void writeInput(FILE *input, char keywords[][MAX_KEYWORD_LENGTH+1], int keyword_count, long size) {
+    long written = 0;
+    int words = 0;
+    while (written < size) {
+        unsigned int kind = nextRandom(3);
+        if (kind == 0 && keyword_count > 0) {
+            written += fprintf(input, "%s", keywords[nextRandom(keyword_count)]);
+        }
+        else if (kind == 1) {
+            int length = 1 + nextRandom(12), i;
+            for (i = 0; i < length; i++) {
+                fputc(i > 0 && nextRandom(4) == 0 ? '0' + nextRandom(10) : randomLetter(), input);
+            }
+            written += length;
+        }
+        else {
+            written += fprintf(input, "%u", nextRandom(100000));
+        }
+        words++;
+        fputc(words % 10 == 0 ? '\n' : ' ', input);
+        written++;
+    }
+}
+
+int main(int argc, char **argv) {
+    if (argc != 7) {
+        fprintf(stderr, "usage: %s <keyword rules> <class rules> <closure rules> <input bytes> <spec.lex> <input.txt>\n", argv[0]);
+        exit(EXIT_FAILURE);
+    }
+    int keyword_count = atoi(argv[1]);
+    int class_count = atoi(argv[2]);
+    int closure_count = atoi(argv[3]);
+    long input_size = atol(argv[4]);
+
+    FILE *spec = fopen(argv[5], "w");
+    FILE *input = fopen(argv[6], "w");
+    if (spec == NULL || input == NULL) {
+        fprintf(stderr, "Fatal error while creating the benchmark files.\n");
+        exit(EXIT_FAILURE);
+    }
+
+    char (*keywords)[MAX_KEYWORD_LENGTH+1] = malloc(sizeof(*keywords) * (keyword_count + 1));
+    int i;
+    for (i = 0; i < keyword_count; i++) {
+        makeKeyword(keywords[i]);
+    }
+
+    writeOptions(spec);
+    writeDefinitions(spec, class_count);
+    writeRules(spec, keywords, keyword_count, class_count, closure_count);
+    writeInput(input, keywords, keyword_count, input_size);
+
+    fclose(spec);
+    fclose(input);
+    free(keywords);
+    return 0;
+}
@@ -0,0 +1,274 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "misc.h"
+#include "quadruple.h"
+#include "binaryir.h"
+
+extern void processQuadruple(quadruple q);
+
+#define BINARY_IR_MAGIC "QIR2"
+#define HEADER_SIZE 16
+#define RECORD_SIZE 24
+
+static unsigned int getWord(const unsigned char *p) {
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((unsigned int)p[3] << 24);
+}
+
+static void putWord(unsigned char *p, unsigned int w) {
+    p[0] = w & 0xff;
+    p[1] = (w >> 8) & 0xff;
+    p[2] = (w >> 16) & 0xff;
+    p[3] = (w >> 24) & 0xff;
+}
+
+// An operand value: the low word, then the high word.
+static unsigned long long getValue(const unsigned char *p) {
+    return getWord(p) | ((unsigned long long)getWord(p + 4) << 32);
+}
+
+static void putValue(unsigned char *p, unsigned long long v) {
+    putWord(p, (unsigned int)v);
+    putWord(p + 4, (unsigned int)(v >> 32));
+}
+
+/* Returns 1 if the file starts with the magic of the binary format. What is read
+ from a pipe is gone, so only a regular file is looked at; anything else is text,
+ read once by the parser. The binary form is mapped, so it has to be a file. */
+int isBinaryProgram(char *filename) {
+    char magic[4];
+    struct stat st;
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0 || fstat(fd, &st) != 0) {
+        abortMessage("Error: Failed to open file [%s]", filename);
+    }
+    int is_binary = (S_ISREG(st.st_mode) && read(fd, magic, 4) == 4 && memcmp(magic, BINARY_IR_MAGIC, 4) == 0);
+    close(fd);
+    return is_binary;
+}
+
+static void corruptProgram(char *filename) {
+    abortMessage("Error: [%s] is not a valid binary IR file.", filename);
+}
+
+static int isLetter(char c) {
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z');
+}
+
+static int isDigit(char c) {
+    return c >= '0' && c <= '9';
+}
+
+/* A name the text IR can hold, as ir.lex scans it: a letter followed by letters
+ and digits that is not a keyword, or '_' followed by digits. */
+static int isProgramName(const char *name, size_t length) {
+    size_t i;
+    if (length < 2 && !(length == 1 && isLetter(name[0]))) {
+        return 0;
+    }
+    for (i = 1; i < length; i++) {
+        if (!(isDigit(name[i]) || (isLetter(name[i]) && name[0] != '_'))) {
+            return 0;
+        }
+    }
+    if (name[0] == '_') {
+        return 1;
+    }
+    return isLetter(name[0]) && strcmp(name, "goto") != 0 && strcmp(name, "if") != 0 &&
+           strcmp(name, "function") != 0;
+}
+
+// The operands of a quadruple as the parser builds it for the operator.
+static int hasOperandsOf(operator operation, operand operand1, operand operand2) {
+    switch (operation) {
+        case ASSIGNMENT:
+        case IFGOTOOP:
+            return operand1.kind != NO_OPERAND && operand2.kind == NO_OPERAND;
+        case LABELOP:
+        case GOTOOP:
+        case FUNCTIONOP:
+            return operand1.kind == NO_OPERAND && operand2.kind == NO_OPERAND;
+        default:
+            return operand1.kind != NO_OPERAND && operand2.kind != NO_OPERAND;
+    }
+}
+
+/* The file symbols are interned at their first use, in the order the parser would
+ intern them, so both forms give the same output. */
+static symbolId fileSymbol(unsigned long long s, const char **names, symbolId *symbols, int *interned,
+                           unsigned int symbol_count, char *filename) {
+    if (s >= symbol_count) {
+        corruptProgram(filename);
+    }
+    if (!interned[s]) {
+        symbols[s] = internSymbol((char *)names[s]);
+        interned[s] = 1;
+    }
+    return symbols[s];
+}
+
+void readBinaryProgram(char *filename) {
+    int fd = open(filename, O_RDONLY);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) != 0) {
+        abortMessage("Error: Failed to open file [%s]", filename);
+    }
+    size_t size = st.st_size;
+    if (size < HEADER_SIZE) {
+        corruptProgram(filename);
+    }
+    const unsigned char *data = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (data == MAP_FAILED) {
+        abortMessage("Error: Failed to map file [%s]", filename);
+    }
+    close(fd);
+
+    unsigned int symbol_count = getWord(data + 4);
+    size_t names_size = getWord(data + 8);
+    size_t quadruple_count = getWord(data + 12);
+    size_t names_end = HEADER_SIZE + ((names_size + 3) & ~(size_t)3);
+    if (names_end > size || (size - names_end) / RECORD_SIZE < quadruple_count ||
+        (size_t)symbol_count > names_size) {
+        corruptProgram(filename);
+    }
+
+    /* The names are used straight from the mapping. */
+    const char **names = safeMalloc((symbol_count + 1) * sizeof(char *));
+    symbolId *symbols = safeMalloc((symbol_count + 1) * sizeof(symbolId));
+    int *interned = safeMalloc((symbol_count + 1) * sizeof(int));
+    const char *name = (const char *)data + HEADER_SIZE, *names_limit = name + names_size;
+    unsigned int s;
+    for (s = 0; s < symbol_count; s++) {
+        const char *end = memchr(name, '\0', names_limit - name);
+        if (end == NULL || !isProgramName(name, end - name)) {
+            corruptProgram(filename);
+        }
+        names[s] = name;
+        interned[s] = 0;
+        name = end + 1;
+    }
+
+    const unsigned char *record = data + names_end;
+    size_t i;
+    for (i = 0; i < quadruple_count; i++, record += RECORD_SIZE) {
+        operand op[2];
+        int k;
+        symbolId lhs = fileSymbol(getWord(record), names, symbols, interned, symbol_count, filename);
+        if (record[4] > FUNCTIONOP || record[7] != 0) {
+            corruptProgram(filename);
+        }
+        for (k = 0; k < 2; k++) {
+            unsigned long long value = getValue(record + 8 + 8 * k);
+            switch (record[5 + k]) {
+                case NO_OPERAND:
+                    op[k] = makeNoOperand();
+                    break;
+                case CONSTANT_OPERAND:
+                    op[k] = makeConstantOperand((constantValue)value);
+                    break;
+                case VARIABLE_OPERAND:
+                    op[k] = makeVariableOperand(fileSymbol(value, names, symbols, interned, symbol_count, filename));
+                    break;
+                default:
+                    corruptProgram(filename);
+            }
+        }
+        if (!hasOperandsOf((operator)record[4], op[0], op[1])) {
+            corruptProgram(filename);
+        }
+        processQuadruple(makeQuadruple(lhs, (operator)record[4], op[0], op[1]));
+    }
+
+    free(interned);
+    free(symbols);
+    free(names);
+    munmap((void *)data, size);
+}
+
+static void writeBytes(FILE *f, const void *bytes, size_t count) {
+    if (fwrite(bytes, 1, count, f) != count) {
+        abortMessage("Error: failed to write the binary IR.");
+    }
+}
+
+/* Numbers s in the file if it has no number yet. */
+static void numberSymbol(symbolId s, int *file_symbol, symbolId *order, unsigned int *count, size_t *names_size) {
+    if (file_symbol[s] == -1) {
+        file_symbol[s] = *count;
+        order[(*count)++] = s;
+        *names_size += strlen(getSymbolName(s)) + 1;
+    }
+}
+
+static unsigned long long operandValue(operand op, int *file_symbol) {
+    return (op.kind == VARIABLE_OPERAND ? (unsigned int)file_symbol[op.value] : (unsigned long long)op.value);
+}
+
+// Writes the queues of the contexts, in order, as one binary program.
+void fwriteBinaryProgram(FILE *f, optimizerContext **contexts, int context_count) {
+    int symbol_count = getSymbolCount();
+    int *file_symbol = safeMalloc((symbol_count + 1) * sizeof(int));
+    symbolId *order = safeMalloc((symbol_count + 1) * sizeof(symbolId));
+    unsigned int file_symbol_count = 0, quadruple_count = 0, s;
+    size_t names_size = 0;
+    unsigned char buffer[RECORD_SIZE];
+    int c, i;
+
+    for (i = 0; i < symbol_count; i++) {
+        file_symbol[i] = -1;
+    }
+    for (c = 0; c < context_count; c++) {
+        quadrupleQueue *queue = &contexts[c]->queue;
+        for (i = 0; i < queue->size; i++) {
+            quadruple q = queue->entries[i].quad;
+            if (queue->entries[i].removed_quadruple) {
+                continue;
+            }
+            numberSymbol(q.lhs, file_symbol, order, &file_symbol_count, &names_size);
+            if (q.operand1.kind == VARIABLE_OPERAND) {
+                numberSymbol(q.operand1.value, file_symbol, order, &file_symbol_count, &names_size);
+            }
+            if (q.operand2.kind == VARIABLE_OPERAND) {
+                numberSymbol(q.operand2.value, file_symbol, order, &file_symbol_count, &names_size);
+            }
+            quadruple_count++;
+        }
+    }
+
+    memcpy(buffer, BINARY_IR_MAGIC, 4);
+    putWord(buffer + 4, file_symbol_count);
+    putWord(buffer + 8, names_size);
+    putWord(buffer + 12, quadruple_count);
+    writeBytes(f, buffer, HEADER_SIZE);
+    for (s = 0; s < file_symbol_count; s++) {
+        char *name = getSymbolName(order[s]);
+        writeBytes(f, name, strlen(name) + 1);
+    }
+    memset(buffer, 0, sizeof(buffer));
+    writeBytes(f, buffer, ((names_size + 3) & ~(size_t)3) - names_size);
+
+    for (c = 0; c < context_count; c++) {
+        quadrupleQueue *queue = &contexts[c]->queue;
+        for (i = 0; i < queue->size; i++) {
+            quadruple q = queue->entries[i].quad;
+            if (queue->entries[i].removed_quadruple) {
+                continue;
+            }
+            putWord(buffer, file_symbol[q.lhs]);
+            buffer[4] = q.operation;
+            buffer[5] = q.operand1.kind;
+            buffer[6] = q.operand2.kind;
+            buffer[7] = 0;
+            putValue(buffer + 8, operandValue(q.operand1, file_symbol));
+            putValue(buffer + 16, operandValue(q.operand2, file_symbol));
+            writeBytes(f, buffer, RECORD_SIZE);
+        }
+    }
+
+    free(order);
+    free(file_symbol);
+}
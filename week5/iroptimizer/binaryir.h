@@ -0,0 +1,26 @@
+#ifndef BINARYIR_H
+#define BINARYIR_H
+
+#include <stdio.h>
+#include "context.h"
+
+/* A binary form of the IR, so that programs can be passed between stages without
+ printing and parsing text. All numbers are 32-bit little endian, except the
+ operand values, which are 64-bit so that they hold any constant:
+
+   header     "QIR2", symbol count, size of the names in bytes, quadruple count
+   names      one NUL-terminated name per symbol, padded to a multiple of 4 bytes
+   quadruples 24 bytes each: lhs, then the operator and the two operand kinds
+              as bytes followed by a zero byte, then the two operand values
+
+ Symbols are numbered in the file from 0, in order of first appearance; the lhs
+ and the variable operands hold these numbers. The reader maps the file and hands
+ every quadruple to processQuadruple(), like the parser does. A file the text IR
+ could not express, with a name that is not an identifier or operands that do not
+ fit the operator, is rejected. Only a regular file is taken for binary. */
+
+int isBinaryProgram(char *filename);
+void readBinaryProgram(char *filename);
+void fwriteBinaryProgram(FILE *f, optimizerContext **contexts, int context_count);
+
+#endif
@@ -0,0 +1,172 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "misc.h"
+#include "quadruple.h"
+#include "context.h"
+#include "cfg.h"
+
+static void addSuccessor(basicBlock *block, int successor) {
+    if (block->successor_count == 1 && block->successors[0] == successor) {
+        return; /* "if x goto L;" directly followed by "L:" */
+    }
+    block->successors[block->successor_count++] = successor;
+}
+
+// Depth first search from the entry, recording blocks as they are finished.
+static void computeReversePostorder(controlFlowGraph *cfg) {
+    int block_count = cfg->block_count;
+    char *visited = safeMalloc(block_count * sizeof(char));
+    int *stack = safeMalloc(block_count * sizeof(int));
+    int *next_successor = safeMalloc(block_count * sizeof(int));
+    int i, finished = 0, top = 0;
+
+    cfg->reverse_postorder = safeMalloc(block_count * sizeof(int));
+    for (i = 0; i < block_count; i++) {
+        visited[i] = 0;
+        next_successor[i] = 0;
+    }
+
+    stack[top++] = 0;
+    visited[0] = 1;
+    while (top > 0) {
+        basicBlock *block = &cfg->blocks[stack[top - 1]];
+        if (next_successor[stack[top - 1]] < block->successor_count) {
+            int successor = block->successors[next_successor[stack[top - 1]]++];
+            if (!visited[successor]) {
+                visited[successor] = 1;
+                stack[top++] = successor;
+            }
+        }
+        else {
+            cfg->reverse_postorder[finished++] = stack[--top];
+        }
+    }
+
+    // Reverse the postorder of the reachable blocks, then append the others.
+    for (i = 0; i < finished / 2; i++) {
+        int tmp = cfg->reverse_postorder[i];
+        cfg->reverse_postorder[i] = cfg->reverse_postorder[finished - 1 - i];
+        cfg->reverse_postorder[finished - 1 - i] = tmp;
+    }
+    for (i = 0; i < block_count; i++) {
+        if (!visited[i]) {
+            cfg->reverse_postorder[finished++] = i;
+        }
+    }
+
+    free(next_successor);
+    free(stack);
+    free(visited);
+}
+
+controlFlowGraph *buildControlFlowGraph() {
+    int size = getQuadrupleQueueSize();
+    int symbol_count = getPartitionSymbolCount();
+    controlFlowGraph *cfg = safeMalloc(sizeof(controlFlowGraph));
+    int *label_block = safeMalloc((symbol_count + 1) * sizeof(int)); /* by getPartitionSymbolIndex() */
+    int i, b;
+
+    for (i = 0; i < symbol_count; i++) {
+        label_block[i] = -1;
+    }
+
+    /* Find the block boundaries: a label starts a block, a jump ends one. */
+    cfg->blocks = safeMalloc((size + 1) * sizeof(basicBlock));
+    cfg->block_count = 0;
+    int block_open = 0;
+    for (i = 0; i < size; i++) {
+        quadrupleEntry *entry = getQuadrupleEntry(i);
+        if (entry->removed_quadruple) {
+            continue;
+        }
+        if (entry->quad.operation == LABELOP || !block_open) {
+            if (block_open) {
+                cfg->blocks[cfg->block_count - 1].last = i;
+            }
+            cfg->blocks[cfg->block_count].first = i;
+            cfg->block_count++;
+            block_open = 1;
+        }
+        if (entry->quad.operation == LABELOP) {
+            int label = getPartitionSymbolIndex(entry->quad.lhs);
+            if (label_block[label] != -1) {
+                fprintf(stderr, "Error: label \"%s\" is defined twice.\n", getSymbolName(entry->quad.lhs));
+                exit(EXIT_FAILURE);
+            }
+            label_block[label] = cfg->block_count - 1;
+        }
+        if (isJump(entry->quad)) {
+            cfg->blocks[cfg->block_count - 1].last = i + 1;
+            block_open = 0;
+        }
+    }
+    if (block_open) {
+        cfg->blocks[cfg->block_count - 1].last = size;
+    }
+    if (cfg->block_count == 0) {
+        /* An empty program is one empty block. */
+        cfg->blocks[0].first = cfg->blocks[0].last = size;
+        cfg->block_count = 1;
+    }
+
+    /* Connect the blocks. */
+    for (b = 0; b < cfg->block_count; b++) {
+        basicBlock *block = &cfg->blocks[b];
+        block->successor_count = 0;
+        block->predecessor_count = 0;
+        block->predecessors = NULL;
+        block->falls_to_exit = 0;
+
+        quadruple *terminator = NULL;
+        for (i = block->last - 1; i >= block->first && terminator == NULL; i--) {
+            if (!getQuadrupleEntry(i)->removed_quadruple) {
+                terminator = &getQuadrupleEntry(i)->quad;
+            }
+        }
+        if (terminator != NULL && isJump(*terminator)) {
+            int target = label_block[getPartitionSymbolIndex(terminator->lhs)];
+            if (target == -1) {
+                fprintf(stderr, "Error: jump to undefined label \"%s\".\n", getSymbolName(terminator->lhs));
+                exit(EXIT_FAILURE);
+            }
+            addSuccessor(block, target);
+        }
+        if (terminator == NULL || terminator->operation != GOTOOP) {
+            if (b + 1 < cfg->block_count) {
+                addSuccessor(block, b + 1);
+            }
+            else {
+                block->falls_to_exit = 1;
+            }
+        }
+    }
+    for (b = 0; b < cfg->block_count; b++) {
+        for (i = 0; i < cfg->blocks[b].successor_count; i++) {
+            cfg->blocks[cfg->blocks[b].successors[i]].predecessor_count++;
+        }
+    }
+    for (b = 0; b < cfg->block_count; b++) {
+        cfg->blocks[b].predecessors = safeMalloc((cfg->blocks[b].predecessor_count + 1) * sizeof(int));
+        cfg->blocks[b].predecessor_count = 0;
+    }
+    for (b = 0; b < cfg->block_count; b++) {
+        for (i = 0; i < cfg->blocks[b].successor_count; i++) {
+            basicBlock *successor = &cfg->blocks[cfg->blocks[b].successors[i]];
+            successor->predecessors[successor->predecessor_count++] = b;
+        }
+    }
+
+    computeReversePostorder(cfg);
+    free(label_block);
+    return cfg;
+}
+
+void destroyControlFlowGraph(controlFlowGraph *cfg) {
+    int b;
+    for (b = 0; b < cfg->block_count; b++) {
+        free(cfg->blocks[b].predecessors);
+    }
+    free(cfg->blocks);
+    free(cfg->reverse_postorder);
+    free(cfg);
+}
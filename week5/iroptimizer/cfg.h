@@ -0,0 +1,27 @@
+#ifndef CFG_H
+#define CFG_H
+
+/* Control flow graph over the quadruple queue. A basic block is a range of queue
+ indices: it starts at the first quadruple, at a label or after a jump, and ends
+ before the next such point. Removed quadruples inside a range are skipped. */
+
+typedef struct basicBlock {
+    int first;               /* index of the first quadruple */
+    int last;                /* index one past the last quadruple */
+    int successors[2];
+    int successor_count;
+    int *predecessors;
+    int predecessor_count;
+    int falls_to_exit;       /* control can leave the program at the end of the block */
+} basicBlock;
+
+typedef struct controlFlowGraph {
+    basicBlock *blocks;      /* blocks[0] is the entry */
+    int block_count;
+    int *reverse_postorder;  /* every block once; unreachable blocks come last */
+} controlFlowGraph;
+
+controlFlowGraph *buildControlFlowGraph();
+void destroyControlFlowGraph(controlFlowGraph *cfg);
+
+#endif
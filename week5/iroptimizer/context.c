@@ -0,0 +1,101 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "misc.h"
+#include "context.h"
+#include "defuse.h"
+
+static __thread optimizerContext *current_context = NULL;
+
+optimizerContext *createOptimizerContext() {
+    optimizerContext *context = safeMalloc(sizeof(optimizerContext));
+    optimizerContext *previous = current_context;
+    int pass;
+
+    /* The initializers work on the context of the calling thread. */
+    current_context = context;
+    context->queue.entries = NULL;
+    context->queue.version = 0;
+    initializeSymbolMap(&context->symbols);
+    context->expressions.nodes = NULL;
+    context->expressions.buckets = NULL;
+    context->expressions.bucket_epochs = NULL;
+    context->expressions.value_numbers = NULL;
+    context->expressions.value_epochs = NULL;
+    initializeSymbolMap(&context->expressions.variables);
+    context->def_use = NULL;
+    context->ssa = NULL;
+    context->ends_program = 0;
+    for (pass = 0; pass < PASS_COUNT; pass++) {
+        context->statistics[pass].seconds = 0.0;
+        context->statistics[pass].removed = 0;
+        context->statistics[pass].rewritten = 0;
+        context->statistics[pass].peak_size = 0;
+    }
+    initializeQuadrupleQueue();
+    initializeAvailableExpressions();
+    context->copies = createCopyTable();
+    context->chains = createChainTable();
+    current_context = previous;
+
+    return context;
+}
+
+/* The tables of the passes that run while the partition is parsed. The global
+ passes only need the queue, so the tables go as soon as the partition ends
+ instead of staying with every partition until the program exits. */
+void releaseForwardPassTables(optimizerContext *context) {
+    optimizerContext *previous = current_context;
+
+    current_context = context;
+    destroyAvailableExpressions();
+    if (context->copies != NULL) {
+        destroyCopyTable(context->copies);
+        destroyChainTable(context->chains);
+        context->copies = NULL;
+        context->chains = NULL;
+    }
+    current_context = previous;
+}
+
+void destroyOptimizerContext(optimizerContext *context) {
+    optimizerContext *previous = current_context;
+
+    releaseForwardPassTables(context);
+    current_context = context;
+    destroyQuadrupleQueue();
+    discardDefUseChains();
+    destroySymbolMap(&context->symbols);
+    current_context = (previous == context ? NULL : previous);
+
+    free(context);
+}
+
+void setOptimizerContext(optimizerContext *context) {
+    current_context = context;
+}
+
+optimizerContext *getOptimizerContext() {
+    if (current_context == NULL) {
+        fprintf(stderr, "Error: no optimizer context for this thread.\n");
+        exit(EXIT_FAILURE);
+    }
+    return current_context;
+}
+
+int addPartitionSymbol(symbolId s) {
+    return insertSymbolIndex(&getOptimizerContext()->symbols, s);
+}
+
+// The index of s, or -1 if no quadruple of the partition has used it.
+int getPartitionSymbolIndex(symbolId s) {
+    return findSymbolIndex(&getOptimizerContext()->symbols, s);
+}
+
+int getPartitionSymbolCount() {
+    return getOptimizerContext()->symbols.size;
+}
+
+// The symbols by index; valid until the next symbol is added.
+symbolId *getPartitionSymbols() {
+    return getOptimizerContext()->symbols.symbols;
+}
@@ -0,0 +1,46 @@
+#ifndef CONTEXT_H
+#define CONTEXT_H
+
+#include "quadruple.h"
+#include "subexpression.h"
+#include "copytable.h"
+#include "simplify.h"
+#include "deadcode.h"
+#include "passes.h"
+#include "symbolmap.h"
+
+struct ssaPass;
+struct defUseChains;
+
+/* Everything one partition of the program is optimized with. A thread works on one
+ context at a time, and the modules find the context of the calling thread through
+ getOptimizerContext(), so their functions need no extra parameter. Only the symbol
+ table and the options are shared between contexts. */
+typedef struct optimizerContext {
+    quadrupleQueue queue;
+    symbolMap symbols;             /* every symbol the queue has held, see getPartitionSymbolIndex() */
+    availableExpressionTable expressions;
+    copyTable *copies;             /* NULL once the partition is parsed, as is chains */
+    chainTable *chains;
+    struct defUseChains *def_use;  /* see defuse.h; NULL until a pass asks for them */
+    struct ssaPass *ssa;           /* scratch of runSSAOptimizations() */
+    int ends_program;              /* the last partition, at whose end -live= holds */
+    passStatistics statistics[PASS_COUNT];
+} optimizerContext;
+
+optimizerContext *createOptimizerContext();
+void releaseForwardPassTables(optimizerContext *context);
+void destroyOptimizerContext(optimizerContext *context);
+void setOptimizerContext(optimizerContext *context);
+optimizerContext *getOptimizerContext();
+
+/* The symbols of the partition of the calling thread, numbered 0, 1, ... so that
+ the global passes can size their tables by the partition rather than by the
+ whole symbol table. Every quadruple inserted in the queue adds its symbols; a
+ pass that renames in place adds the new names itself. */
+int addPartitionSymbol(symbolId s);
+int getPartitionSymbolIndex(symbolId s);
+int getPartitionSymbolCount();
+symbolId *getPartitionSymbols();
+
+#endif
@@ -0,0 +1,163 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "misc.h"
+#include "copytable.h"
+#include "symbolmap.h"
+
+/* A list of variables, by their index in the map of the table. */
+typedef struct symbolList {
+    int *symbols;
+    int size;
+    int allocated_size;
+} symbolList;
+
+struct copyTable {
+    symbolMap map;         /* numbers the variables the table has seen */
+    operand *values;       /* indexed by map index, NO_OPERAND if no copy is known */
+    symbolList *copied_to; /* indexed by map index: the variables that may hold a copy of it */
+    char *touched;         /* indexed by map index: 1 if listed in touched_list */
+    int size;
+    int entry_count;       /* variables that hold a copy */
+    symbolList touched_list; /* variables whose entries changed since the last clear */
+};
+
+static void appendToSymbolList(symbolList *list, int s) {
+    if (list->size == list->allocated_size) {
+        list->allocated_size = (list->allocated_size == 0 ? 4 : 2 * list->allocated_size);
+        list->symbols = safeRealloc(list->symbols, list->allocated_size * sizeof(int));
+    }
+    list->symbols[list->size++] = s;
+}
+
+static void touchSymbol(copyTable *table, int s) {
+    if (!table->touched[s]) {
+        table->touched[s] = 1;
+        appendToSymbolList(&table->touched_list, s);
+    }
+}
+
+// The map index of var, which gets an entry if it has none yet.
+static int insertVariable(copyTable *table, symbolId var) {
+    int index = insertSymbolIndex(&table->map, var);
+    if (index < table->size) {
+        return index;
+    }
+    int new_size = (table->size == 0 ? 16 : 2 * table->size);
+    table->values = safeRealloc(table->values, new_size * sizeof(operand));
+    table->copied_to = safeRealloc(table->copied_to, new_size * sizeof(symbolList));
+    table->touched = safeRealloc(table->touched, new_size * sizeof(char));
+    int i;
+    for (i = table->size; i < new_size; i++) {
+        table->values[i] = makeNoOperand();
+        table->touched[i] = 0;
+        table->copied_to[i].symbols = NULL;
+        table->copied_to[i].size = 0;
+        table->copied_to[i].allocated_size = 0;
+    }
+    table->size = new_size;
+    return index;
+}
+
+copyTable *createCopyTable() {
+    copyTable *table = safeMalloc(sizeof(copyTable));
+    initializeSymbolMap(&table->map);
+    table->values = NULL;
+    table->copied_to = NULL;
+    table->touched = NULL;
+    table->size = 0;
+    table->entry_count = 0;
+    table->touched_list.symbols = NULL;
+    table->touched_list.size = 0;
+    table->touched_list.allocated_size = 0;
+    return table;
+}
+
+// Record that var holds value. Any previous copy in var is replaced.
+void insertCopy(copyTable *table, symbolId var, operand value) {
+    int index = insertVariable(table, var);
+    touchSymbol(table, index);
+    if (table->values[index].kind == NO_OPERAND) {
+        table->entry_count++;
+    }
+    table->values[index] = value;
+    if (value.kind == VARIABLE_OPERAND) {
+        int source = insertVariable(table, value.value);
+        touchSymbol(table, source);
+        appendToSymbolList(&table->copied_to[source], index);
+    }
+}
+
+// Returns the value copied into var, or NO_OPERAND.
+operand lookupCopy(copyTable *table, symbolId var) {
+    int index = findSymbolIndex(&table->map, var);
+    if (index == -1) {
+        return makeNoOperand();
+    }
+    return table->values[index];
+}
+
+// Returns the value copied into op if op is a variable with a known copy, op otherwise.
+operand replaceWithCopy(copyTable *table, operand op) {
+    if (op.kind == VARIABLE_OPERAND) {
+        operand value = lookupCopy(table, op.value);
+        if (value.kind != NO_OPERAND) {
+            return value;
+        }
+    }
+    return op;
+}
+
+/* var is redefined: drop its own copy and the copies of var held elsewhere. The lists
+ are not updated when a copy is overwritten, so an entry only counts if the variable
+ still holds var. */
+void killCopies(copyTable *table, symbolId var) {
+    int index = findSymbolIndex(&table->map, var);
+    if (index == -1) {
+        return;
+    }
+    if (table->values[index].kind != NO_OPERAND) {
+        table->values[index] = makeNoOperand();
+        table->entry_count--;
+    }
+
+    symbolList *list = &table->copied_to[index];
+    int i;
+    for (i = 0; i < list->size; i++) {
+        int holder = list->symbols[i];
+        if (isVariableOperand(table->values[holder], var)) {
+            table->values[holder] = makeNoOperand();
+            table->entry_count--;
+        }
+    }
+    list->size = 0;
+}
+
+void clearCopyTable(copyTable *table) {
+    int i;
+    for (i = 0; i < table->touched_list.size; i++) {
+        int index = table->touched_list.symbols[i];
+        table->values[index] = makeNoOperand();
+        table->copied_to[index].size = 0;
+        table->touched[index] = 0;
+    }
+    table->touched_list.size = 0;
+    table->entry_count = 0;
+}
+
+// Returns the number of variables that hold a copy.
+int getCopyTableSize(copyTable *table) {
+    return table->entry_count;
+}
+
+void destroyCopyTable(copyTable *table) {
+    int i;
+    for (i = 0; i < table->size; i++) {
+        free(table->copied_to[i].symbols);
+    }
+    free(table->values);
+    free(table->copied_to);
+    free(table->touched);
+    free(table->touched_list.symbols);
+    destroySymbolMap(&table->map);
+    free(table);
+}
@@ -0,0 +1,24 @@
+#ifndef COPYTABLE_H
+#define COPYTABLE_H
+
+#include "quadruple.h"
+
+/* Copies known to hold at a program point: variable -> operand (a variable or a
+ constant). The variables are numbered by a symbol map of the table's own (see
+ symbolmap.h), so the table only grows with the variables it has seen, and every
+ variable keeps the list of variables copied from it, so a redefinition only kills
+ the copies that mention it. Tables are independent objects, so any pass can keep
+ its own. */
+
+typedef struct copyTable copyTable;
+
+copyTable *createCopyTable();
+void insertCopy(copyTable *table, symbolId var, operand value);
+operand lookupCopy(copyTable *table, symbolId var);
+operand replaceWithCopy(copyTable *table, operand op);
+void killCopies(copyTable *table, symbolId var);
+void clearCopyTable(copyTable *table);
+int getCopyTableSize(copyTable *table);
+void destroyCopyTable(copyTable *table);
+
+#endif
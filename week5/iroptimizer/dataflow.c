@@ -0,0 +1,547 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "misc.h"
+#include "quadruple.h"
+#include "context.h"
+#include "dataflow.h"
+
+static intSet makeUniverse(unsigned int size) {
+    intSet s = makeEmptyIntSet();
+    unsigned int n;
+    if (size > 0) {
+        insertIntSet(size - 1, &s); /* allocates the whole vector at once */
+    }
+    for (n = 0; n + 1 < size; n++) {
+        insertIntSet(n, &s);
+    }
+    return s;
+}
+
+static void meetIntSet(dataflowMeet meet, intSet *lhs, intSet rhs) {
+    if (meet == UNION_MEET) {
+        unionIntSet(lhs, rhs);
+    }
+    else {
+        intersectionIntSet(lhs, rhs);
+    }
+}
+
+dataflowSolution solveDataflow(controlFlowGraph *cfg, dataflowProblem *problem) {
+    int block_count = cfg->block_count;
+    int forward = (problem->direction == FORWARD_DATAFLOW);
+    char *pending = safeMalloc(block_count * sizeof(char));
+    dataflowSolution solution;
+    intSet *before, *after; /* in the direction of the problem */
+    int i, b, changed = 1;
+
+    solution.block_count = block_count;
+    solution.in = safeMalloc(block_count * sizeof(intSet));
+    solution.out = safeMalloc(block_count * sizeof(intSet));
+    before = (forward ? solution.in : solution.out);
+    after = (forward ? solution.out : solution.in);
+    for (b = 0; b < block_count; b++) {
+        before[b] = makeEmptyIntSet();
+        after[b] = (problem->meet == INTERSECTION_MEET ? makeUniverse(problem->universe_size) : makeEmptyIntSet());
+        pending[b] = 1;
+    }
+
+    while (changed) {
+        changed = 0;
+        for (i = 0; i < block_count; i++) {
+            b = cfg->reverse_postorder[forward ? i : block_count - 1 - i];
+            if (!pending[b]) {
+                continue;
+            }
+            pending[b] = 0;
+
+            basicBlock *block = &cfg->blocks[b];
+            int *neighbours = (forward ? block->predecessors : block->successors);
+            int neighbour_count = (forward ? block->predecessor_count : block->successor_count);
+            int at_boundary = (forward ? b == 0 : block->falls_to_exit);
+            int n, first = 1;
+
+            /* Combine the sets flowing in from the neighbours (and the boundary). A block
+             without any of them, i.e. an unreachable one, starts from the empty set. */
+            freeIntSet(before[b]);
+            before[b] = makeEmptyIntSet();
+            if (at_boundary) {
+                unionIntSet(&before[b], problem->boundary);
+                first = 0;
+            }
+            for (n = 0; n < neighbour_count; n++) {
+                if (first) {
+                    unionIntSet(&before[b], after[neighbours[n]]);
+                    first = 0;
+                }
+                else {
+                    meetIntSet(problem->meet, &before[b], after[neighbours[n]]);
+                }
+            }
+
+            intSet result;
+            if (problem->transfer != NULL) {
+                result = problem->transfer(cfg, b, before[b]);
+            }
+            else {
+                result = copyIntSet(before[b]);
+                differenceIntSet(&result, problem->kill[b]);
+                unionIntSet(&result, problem->gen[b]);
+            }
+            if (isEqualIntSet(result, after[b])) {
+                freeIntSet(result);
+                continue;
+            }
+            freeIntSet(after[b]);
+            after[b] = result;
+
+            /* Revisit the blocks that depend on this one. */
+            neighbours = (forward ? block->successors : block->predecessors);
+            neighbour_count = (forward ? block->successor_count : block->predecessor_count);
+            for (n = 0; n < neighbour_count; n++) {
+                pending[neighbours[n]] = 1;
+            }
+            changed = 1;
+        }
+    }
+
+    free(pending);
+    return solution;
+}
+
+void freeDataflowSolution(dataflowSolution solution) {
+    int b;
+    for (b = 0; b < solution.block_count; b++) {
+        freeIntSet(solution.in[b]);
+        freeIntSet(solution.out[b]);
+    }
+    free(solution.in);
+    free(solution.out);
+}
+
+static void freeDataflowProblem(dataflowProblem *problem, int block_count) {
+    int b;
+    for (b = 0; b < block_count; b++) {
+        freeIntSet(problem->gen[b]);
+        freeIntSet(problem->kill[b]);
+    }
+    free(problem->gen);
+    free(problem->kill);
+    freeIntSet(problem->boundary);
+}
+
+static void initializeDataflowProblem(dataflowProblem *problem, int block_count, dataflowDirection direction,
+                                      dataflowMeet meet, unsigned int universe_size) {
+    int b;
+    problem->direction = direction;
+    problem->meet = meet;
+    problem->universe_size = universe_size;
+    problem->boundary = makeEmptyIntSet();
+    problem->gen = safeMalloc(block_count * sizeof(intSet));
+    problem->kill = safeMalloc(block_count * sizeof(intSet));
+    problem->transfer = NULL;
+    for (b = 0; b < block_count; b++) {
+        problem->gen[b] = makeEmptyIntSet();
+        problem->kill[b] = makeEmptyIntSet();
+    }
+}
+
+/* Liveness: a use makes a variable live, a definition kills it. */
+dataflowSolution computeLiveness(controlFlowGraph *cfg, intSet live_at_exit) {
+    dataflowProblem problem;
+    int b, i;
+
+    initializeDataflowProblem(&problem, cfg->block_count, BACKWARD_DATAFLOW, UNION_MEET, getSymbolCount());
+    unionIntSet(&problem.boundary, live_at_exit);
+    for (b = 0; b < cfg->block_count; b++) {
+        for (i = cfg->blocks[b].last - 1; i >= cfg->blocks[b].first; i--) {
+            quadrupleEntry *entry = getQuadrupleEntry(i);
+            if (entry->removed_quadruple) {
+                continue;
+            }
+            if (definesVariable(entry->quad)) {
+                insertIntSet(entry->quad.lhs, &problem.kill[b]);
+                deleteIntSet(entry->quad.lhs, &problem.gen[b]);
+            }
+            if (entry->quad.operand1.kind == VARIABLE_OPERAND) {
+                insertIntSet(entry->quad.operand1.value, &problem.gen[b]);
+            }
+            if (entry->quad.operand2.kind == VARIABLE_OPERAND) {
+                insertIntSet(entry->quad.operand2.value, &problem.gen[b]);
+            }
+        }
+    }
+
+    dataflowSolution solution = solveDataflow(cfg, &problem);
+    freeDataflowProblem(&problem, cfg->block_count);
+    return solution;
+}
+
+// Takes live back over quad; returns whether quad is needed.
+static int transferStrongLiveness(quadruple quad, intSet *live) {
+    if (definesVariable(quad)) {
+        if (!isMemberIntSet(quad.lhs, *live)) {
+            return 0;
+        }
+        deleteIntSet(quad.lhs, live);
+    }
+    if (quad.operand1.kind == VARIABLE_OPERAND) {
+        insertIntSet(quad.operand1.value, live);
+    }
+    if (quad.operand2.kind == VARIABLE_OPERAND) {
+        insertIntSet(quad.operand2.value, live);
+    }
+    return 1;
+}
+
+/* Whether an operand is live depends on the lhs, so this is not a gen/kill problem:
+ the block is walked backwards on every visit. */
+static intSet transferBlockStrongLiveness(controlFlowGraph *cfg, int b, intSet out) {
+    intSet live = copyIntSet(out);
+    int i;
+    for (i = cfg->blocks[b].last - 1; i >= cfg->blocks[b].first; i--) {
+        quadrupleEntry *entry = getQuadrupleEntry(i);
+        if (!entry->removed_quadruple) {
+            transferStrongLiveness(entry->quad, &live);
+        }
+    }
+    return live;
+}
+
+/* The solver starts from empty sets, so it finds the least solution: a loop that
+ only feeds itself does not keep itself alive. */
+dataflowSolution computeStrongLiveness(controlFlowGraph *cfg, intSet live_at_exit) {
+    dataflowProblem problem;
+
+    initializeDataflowProblem(&problem, cfg->block_count, BACKWARD_DATAFLOW, UNION_MEET, getSymbolCount());
+    unionIntSet(&problem.boundary, live_at_exit);
+    problem.transfer = transferBlockStrongLiveness;
+
+    dataflowSolution solution = solveDataflow(cfg, &problem);
+    freeDataflowProblem(&problem, cfg->block_count);
+    return solution;
+}
+
+/* The last definition of every variable in every block, grouped per variable and
+ indexed by getPartitionSymbolIndex(). Only those can reach the start of another
+ block; the others are killed first. */
+static void groupDefinitionsByVariable(controlFlowGraph *cfg, int **start, int **definitions) {
+    int size = getQuadrupleQueueSize();
+    int symbol_count = getPartitionSymbolCount();
+    int *definitions_start = safeMalloc((symbol_count + 1) * sizeof(int));
+    int *defined_in_block = safeMalloc((symbol_count + 1) * sizeof(int));
+    int *grouped = safeMalloc((size + 1) * sizeof(int));
+    char *is_last = safeMalloc(size + 1);
+    int b, i, var;
+
+    for (var = 0; var <= symbol_count; var++) {
+        definitions_start[var] = 0;
+        defined_in_block[var] = -1;
+    }
+    for (i = 0; i < size; i++) {
+        is_last[i] = 0;
+    }
+    for (b = 0; b < cfg->block_count; b++) {
+        for (i = cfg->blocks[b].last - 1; i >= cfg->blocks[b].first; i--) {
+            quadrupleEntry *entry = getQuadrupleEntry(i);
+            if (entry->removed_quadruple || !definesVariable(entry->quad)) {
+                continue;
+            }
+            var = getPartitionSymbolIndex(entry->quad.lhs);
+            if (defined_in_block[var] != b) {
+                defined_in_block[var] = b;
+                definitions_start[var + 1]++;
+                is_last[i] = 1;
+            }
+        }
+    }
+    for (var = 0; var < symbol_count; var++) {
+        definitions_start[var + 1] += definitions_start[var];
+    }
+    for (i = 0; i < size; i++) {
+        if (is_last[i]) {
+            grouped[definitions_start[getPartitionSymbolIndex(getQuadrupleEntry(i)->quad.lhs)]++] = i;
+        }
+    }
+    for (var = symbol_count; var > 0; var--) {
+        definitions_start[var] = definitions_start[var - 1];
+    }
+    definitions_start[0] = 0;
+    free(is_last);
+    free(defined_in_block);
+    *start = definitions_start;
+    *definitions = grouped;
+}
+
+/* Reaching definitions: a block generates the last definition of every variable it
+ defines, and kills all other definitions of those variables. As the definitions
+ of a variable are numbered together, a kill is a range of whole words. */
+dataflowSolution computeReachingDefinitions(controlFlowGraph *cfg, int **start, int **definitions) {
+    int size = getQuadrupleQueueSize();
+    int *fact = safeMalloc((size + 1) * sizeof(int));
+    int *definitions_start, *grouped;
+    dataflowProblem problem;
+    int b, i;
+
+    groupDefinitionsByVariable(cfg, &definitions_start, &grouped);
+    int count = definitions_start[getPartitionSymbolCount()];
+    for (i = 0; i < size; i++) {
+        fact[i] = -1;
+    }
+    for (i = 0; i < count; i++) {
+        fact[grouped[i]] = i;
+    }
+
+    initializeDataflowProblem(&problem, cfg->block_count, FORWARD_DATAFLOW, UNION_MEET, count);
+    for (b = 0; b < cfg->block_count; b++) {
+        for (i = cfg->blocks[b].first; i < cfg->blocks[b].last; i++) {
+            if (fact[i] != -1) {
+                int var = getPartitionSymbolIndex(getQuadrupleEntry(i)->quad.lhs);
+                insertRangeIntSet(definitions_start[var], definitions_start[var + 1], &problem.kill[b]);
+                insertIntSet(fact[i], &problem.gen[b]);
+            }
+        }
+    }
+
+    dataflowSolution solution = solveDataflow(cfg, &problem);
+    freeDataflowProblem(&problem, cfg->block_count);
+    free(fact);
+    *start = definitions_start;
+    *definitions = grouped;
+    return solution;
+}
+
+/* The operands of + and * in a fixed order, so that a+b and b+a are one expression. */
+static void canonicalExpression(quadruple quad, operand *op1, operand *op2) {
+    *op1 = quad.operand1;
+    *op2 = quad.operand2;
+    if ((quad.operation == PLUSOP || quad.operation == TIMESOP) &&
+        (op1->kind > op2->kind || (op1->kind == op2->kind && op1->value > op2->value))) {
+        operand tmp = *op1;
+        *op1 = *op2;
+        *op2 = tmp;
+    }
+}
+
+static int computesExpression(quadruple quad) {
+    return definesVariable(quad) && quad.operation != ASSIGNMENT;
+}
+
+static unsigned int hashExpression(quadruple quad) {
+    operand op1, op2;
+    canonicalExpression(quad, &op1, &op2);
+    unsigned int hash = 2166136261u;
+    hash = (hash ^ quad.operation) * 16777619u;
+    hash = (hash ^ op1.kind) * 16777619u;
+    hash = (hash ^ (unsigned int)(op1.value ^ (op1.value >> 32))) * 16777619u;
+    hash = (hash ^ op2.kind) * 16777619u;
+    hash = (hash ^ (unsigned int)(op2.value ^ (op2.value >> 32))) * 16777619u;
+    return hash;
+}
+
+static int isSameExpression(quadruple quad1, quadruple quad2) {
+    operand a1, a2, b1, b2;
+    canonicalExpression(quad1, &a1, &a2);
+    canonicalExpression(quad2, &b1, &b2);
+    return quad1.operation == quad2.operation && isEqualOperand(a1, b1) && isEqualOperand(a2, b2);
+}
+
+/* Numbers the expressions of the queue; representative[e] is the first quadruple
+ computing expression e. Returns the number of expressions. */
+static int numberExpressions(int *expression_of_quadruple, int **representative) {
+    int size = getQuadrupleQueueSize();
+    unsigned int table_size = 16, mask;
+    int *table;
+    int i, count = 0;
+
+    while (table_size < 2 * (unsigned int)size) {
+        table_size *= 2;
+    }
+    mask = table_size - 1;
+    table = safeMalloc(table_size * sizeof(int));
+    for (i = 0; i < (int)table_size; i++) {
+        table[i] = -1;
+    }
+    *representative = safeMalloc((size + 1) * sizeof(int));
+
+    for (i = 0; i < size; i++) {
+        quadrupleEntry *entry = getQuadrupleEntry(i);
+        expression_of_quadruple[i] = -1;
+        if (entry->removed_quadruple || !computesExpression(entry->quad)) {
+            continue;
+        }
+        unsigned int slot = hashExpression(entry->quad) & mask;
+        while (table[slot] != -1 &&
+               !isSameExpression(getQuadrupleEntry((*representative)[table[slot]])->quad, entry->quad)) {
+            slot = (slot + 1) & mask;
+        }
+        if (table[slot] == -1) {
+            table[slot] = count;
+            (*representative)[count++] = i;
+        }
+        expression_of_quadruple[i] = table[slot];
+    }
+
+    free(table);
+    return count;
+}
+
+/* Available expressions: a block generates the expressions it computes, and a
+ definition kills every expression that uses the defined variable. */
+dataflowSolution computeAvailableExpressions(controlFlowGraph *cfg, int **expression_of_quadruple) {
+    int size = getQuadrupleQueueSize();
+    int symbol_count = getPartitionSymbolCount();
+    int *expression_of = safeMalloc((size + 1) * sizeof(int));
+    int *representative;
+    int expression_count = numberExpressions(expression_of, &representative);
+    int *uses_start = safeMalloc((symbol_count + 1) * sizeof(int));
+    int *uses = safeMalloc((2 * expression_count + 1) * sizeof(int));
+    dataflowProblem problem;
+    int b, e, i, var;
+
+    /* The expressions using every variable, grouped per variable and indexed by
+     getPartitionSymbolIndex(). */
+    for (var = 0; var <= symbol_count; var++) {
+        uses_start[var] = 0;
+    }
+    for (e = 0; e < expression_count; e++) {
+        quadruple quad = getQuadrupleEntry(representative[e])->quad;
+        if (quad.operand1.kind == VARIABLE_OPERAND) {
+            uses_start[getPartitionSymbolIndex(quad.operand1.value) + 1]++;
+        }
+        if (quad.operand2.kind == VARIABLE_OPERAND && !isEqualOperand(quad.operand1, quad.operand2)) {
+            uses_start[getPartitionSymbolIndex(quad.operand2.value) + 1]++;
+        }
+    }
+    for (var = 0; var < symbol_count; var++) {
+        uses_start[var + 1] += uses_start[var];
+    }
+    for (e = 0; e < expression_count; e++) {
+        quadruple quad = getQuadrupleEntry(representative[e])->quad;
+        if (quad.operand1.kind == VARIABLE_OPERAND) {
+            uses[uses_start[getPartitionSymbolIndex(quad.operand1.value)]++] = e;
+        }
+        if (quad.operand2.kind == VARIABLE_OPERAND && !isEqualOperand(quad.operand1, quad.operand2)) {
+            uses[uses_start[getPartitionSymbolIndex(quad.operand2.value)]++] = e;
+        }
+    }
+    for (var = symbol_count; var > 0; var--) {
+        uses_start[var] = uses_start[var - 1];
+    }
+    uses_start[0] = 0;
+
+    initializeDataflowProblem(&problem, cfg->block_count, FORWARD_DATAFLOW, INTERSECTION_MEET, expression_count);
+    for (b = 0; b < cfg->block_count; b++) {
+        for (i = cfg->blocks[b].first; i < cfg->blocks[b].last; i++) {
+            quadrupleEntry *entry = getQuadrupleEntry(i);
+            if (entry->removed_quadruple || !definesVariable(entry->quad)) {
+                continue;
+            }
+            if (expression_of[i] != -1) {
+                insertIntSet(expression_of[i], &problem.gen[b]);
+            }
+            var = getPartitionSymbolIndex(entry->quad.lhs);
+            int u;
+            for (u = uses_start[var]; u < uses_start[var + 1]; u++) {
+                deleteIntSet(uses[u], &problem.gen[b]);
+                insertIntSet(uses[u], &problem.kill[b]);
+            }
+        }
+    }
+
+    dataflowSolution solution = solveDataflow(cfg, &problem);
+    freeDataflowProblem(&problem, cfg->block_count);
+    free(uses);
+    free(uses_start);
+    free(representative);
+    if (expression_of_quadruple != NULL) {
+        *expression_of_quadruple = expression_of;
+    }
+    else {
+        free(expression_of);
+    }
+    return solution;
+}
+
+static void fprintfSymbolSet(FILE *f, char *title, intSet s) {
+    unsigned int n;
+    fprintf(f, "  %s:", title);
+    for (n = 0; n < s.size * 8 * sizeof(unsigned int); n++) {
+        if (isMemberIntSet(n, s)) {
+            fprintf(f, " %s", getSymbolName(n));
+        }
+    }
+    fprintf(f, "\n");
+}
+
+// Prints the queue indices of the definitions in s, in queue order.
+static void fprintfDefinitionSet(FILE *f, char *title, intSet s, int *definitions) {
+    intSet indices = makeEmptyIntSet();
+    int n;
+    for (n = nextMemberIntSet(s, 0); n != -1; n = nextMemberIntSet(s, n + 1)) {
+        insertIntSet(definitions[n], &indices);
+    }
+    fprintf(f, "  %s:", title);
+    for (n = nextMemberIntSet(indices, 0); n != -1; n = nextMemberIntSet(indices, n + 1)) {
+        fprintf(f, " %d", n);
+    }
+    fprintf(f, "\n");
+    freeIntSet(indices);
+}
+
+static const char *operation_symbols[] = {"=", "+", "-", "*", "/", "<<", ">>"};
+
+static void fprintfExpressionSet(FILE *f, char *title, intSet s, int *expression_of_quadruple) {
+    int i;
+    fprintf(f, "  %s:", title);
+    for (i = 0; i < getQuadrupleQueueSize(); i++) {
+        int e = expression_of_quadruple[i];
+        /* Print every expression once, at its first quadruple. */
+        if (e != -1 && isMemberIntSet(e, s)) {
+            quadruple quad = getQuadrupleEntry(i)->quad;
+            fprintf(f, " ");
+            fprintfOperand(f, quad.operand1);
+            fprintf(f, "%s", operation_symbols[quad.operation]);
+            fprintfOperand(f, quad.operand2);
+            deleteIntSet(e, &s);
+        }
+    }
+    fprintf(f, "\n");
+}
+
+/* Dumps the blocks of the control flow graph with the solutions of the three analyses. */
+void fprintfDataflow(FILE *f, controlFlowGraph *cfg, intSet live_at_exit) {
+    int *expression_of_quadruple, *definitions_start, *definitions;
+    dataflowSolution liveness = computeLiveness(cfg, live_at_exit);
+    dataflowSolution reaching = computeReachingDefinitions(cfg, &definitions_start, &definitions);
+    dataflowSolution available = computeAvailableExpressions(cfg, &expression_of_quadruple);
+    int b, i;
+
+    for (b = 0; b < cfg->block_count; b++) {
+        basicBlock *block = &cfg->blocks[b];
+        fprintf(f, "block %d: quadruples %d..%d, successors", b, block->first, block->last - 1);
+        for (i = 0; i < block->successor_count; i++) {
+            fprintf(f, " %d", block->successors[i]);
+        }
+        fprintf(f, block->falls_to_exit ? " exit\n" : "\n");
+
+        fprintfSymbolSet(f, "live in", liveness.in[b]);
+        fprintfSymbolSet(f, "live out", liveness.out[b]);
+        fprintfDefinitionSet(f, "reaching in", reaching.in[b], definitions);
+        fprintfDefinitionSet(f, "reaching out", reaching.out[b], definitions);
+
+        /* fprintfExpressionSet consumes its set, so it gets copies. */
+        intSet s = copyIntSet(available.in[b]);
+        fprintfExpressionSet(f, "available in", s, expression_of_quadruple);
+        freeIntSet(s);
+        s = copyIntSet(available.out[b]);
+        fprintfExpressionSet(f, "available out", s, expression_of_quadruple);
+        freeIntSet(s);
+    }
+
+    free(expression_of_quadruple);
+    free(definitions);
+    free(definitions_start);
+    freeDataflowSolution(available);
+    freeDataflowSolution(reaching);
+    freeDataflowSolution(liveness);
+}
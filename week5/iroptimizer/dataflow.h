@@ -0,0 +1,62 @@
+#ifndef DATAFLOW_H
+#define DATAFLOW_H
+
+#include <stdio.h>
+#include "intset.h"
+#include "cfg.h"
+
+/* Generic bit-vector dataflow solver. A problem gives a gen and a kill set per
+ block; the transfer function of a block is gen | (x - kill), unless the problem
+ gives a transfer function of its own. The sets of the neighbouring blocks are
+ combined with union or intersection. The solver visits
+ the blocks in reverse postorder (forward problems) or postorder (backward
+ problems) and only revisits a block when one of its inputs changed. */
+
+typedef enum dataflowDirection {
+    FORWARD_DATAFLOW, BACKWARD_DATAFLOW
+} dataflowDirection;
+
+typedef enum dataflowMeet {
+    UNION_MEET, INTERSECTION_MEET
+} dataflowMeet;
+
+typedef struct dataflowProblem {
+    dataflowDirection direction;
+    dataflowMeet meet;
+    unsigned int universe_size; /* the facts are 0 .. universe_size-1 */
+    intSet boundary;            /* holds at the entry (forward) or at the exit (backward) */
+    intSet *gen;                /* per block */
+    intSet *kill;               /* per block */
+    /* If not NULL, returns the new set after block b (in the direction of the
+     problem) for the set before it, and gen and kill are not used. */
+    intSet (*transfer)(controlFlowGraph *cfg, int b, intSet before);
+} dataflowProblem;
+
+typedef struct dataflowSolution {
+    intSet *in;                 /* per block, at the start of the block */
+    intSet *out;                /* per block, at the end of the block */
+    int block_count;
+} dataflowSolution;
+
+dataflowSolution solveDataflow(controlFlowGraph *cfg, dataflowProblem *problem);
+void freeDataflowSolution(dataflowSolution solution);
+
+/* Live variables (symbol ids); live_at_exit holds at the end of the program. */
+dataflowSolution computeLiveness(controlFlowGraph *cfg, intSet live_at_exit);
+/* Strongly live variables: an operand is only live where the quadruple that reads
+ it is a jump or defines a strongly live variable. A definition of a variable that
+ is not strongly live after it is faint: dead itself, or only read by faint code,
+ also around a loop. */
+dataflowSolution computeStrongLiveness(controlFlowGraph *cfg, intSet live_at_exit);
+/* Reaching definitions. Only the last definition of a variable in its block can
+ reach another block. Those are the facts, numbered per variable: fact n is the
+ quadruple at queue index definitions[n], and the facts of var are start[i] ..
+ start[i + 1] - 1 with i = getPartitionSymbolIndex(var). Both arrays are new. */
+dataflowSolution computeReachingDefinitions(controlFlowGraph *cfg, int **start, int **definitions);
+/* Available expressions; expression_of_quadruple (may be NULL) receives a new array
+ that maps every queue index to the number of the expression it computes, or -1. */
+dataflowSolution computeAvailableExpressions(controlFlowGraph *cfg, int **expression_of_quadruple);
+
+void fprintfDataflow(FILE *f, controlFlowGraph *cfg, intSet live_at_exit);
+
+#endif
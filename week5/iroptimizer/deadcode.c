@@ -1,235 +1,122 @@
 #include "deadcode.h"
+#include "context.h"
 #include "quadruple.h"
 #include "misc.h"
-#include "varcount.h"
+#include "intset.h"
+#include "defuse.h"
 #include <string.h>
 #include <stdlib.h>
 
-static DeadVarsList *dead_variables;
+static intSet live_at_exit = {0, NULL};
+static int live_at_exit_given = 0;
 
-void initializeDeadVarsList() {
-    destroyDeadVarsList();
-    dead_variables = NULL;
-}
-
-void insertDeadVariable(char *var_name, int definition_index){
-    DeadVarsList *list_ptr = dead_variables;
-
-    if (list_ptr == NULL) {
-        list_ptr = malloc(sizeof(DeadVarsList));
-        dead_variables = list_ptr;
-    }
-    else {
-        while (list_ptr->next != NULL) {
-            list_ptr = list_ptr->next;
-        }
-        list_ptr->next = malloc(sizeof(DeadVarsList));
-        list_ptr = list_ptr->next;
-    }
-
-    list_ptr->var_name = stringDuplicate(var_name);
-    list_ptr->definition_index = definition_index;
-    list_ptr->next = NULL;
-}
-
-// returns the index of the variable if found, -1 otherwise.
-int lookupDeadVariable(char *var_name) {
-    DeadVarsList *list_ptr = dead_variables;
-    int found = 0;
-    int index = 0;
+/* A copy x = t takes over the expression of the definition of t when that is the
+ only definition the copy reads, the copy is its only use in any block, it does not
+ reach the exit live, and the operands of the expression are not redefined between
+ the two, which are in one block. */
+void runRedundancyConsolidation() {
+    defUseChains *chains = getDefUseChains();
+    int index;
 
-    while (list_ptr != NULL && found != 1) {
-        if (strcmp(var_name, list_ptr->var_name) == 0) {
-            found = 1;
+    for (index = 0; index < getQuadrupleQueueSize(); index++) {
+        quadrupleEntry *entry = getQuadrupleEntry(index);
+        if (entry->removed_quadruple != 0 || entry->quad.operation != ASSIGNMENT) {
+            continue;
         }
-        else {
-            index++;
-            list_ptr = list_ptr->next;
+        int definition = getOperandDefinition(chains, index, 1);
+        if (definition != NO_DEFINITION && getUseCount(chains, definition) == 1 &&
+            !isLiveAtExitDefinition(chains, definition) && holdsOperandValues(chains, definition, index)) {
+            replaceCopyWithDefinition(chains, index);
         }
     }
-    index = found ? index : -1;
-
-    return index;
 }
 
-// Remove variable from Dead List, but does not remove it from the quadruples queue.
-// This function returns the definition index of the variable if resurrected, and -1 if the variable was not found.
-int resurrectVariable(char *var_name) {
-    DeadVarsList *list_ptr = dead_variables;
-    int index = 0;
-    if (list_ptr != NULL) {
-        // First element of the list
-        if (strcmp(var_name, list_ptr->var_name) == 0) {
-            int def_index = list_ptr->definition_index;
-            dead_variables = dead_variables->next;
-            free(list_ptr->var_name);
-            free(list_ptr);
-            return def_index;
-        }
-        else {
-            while (list_ptr->next != NULL) {
-                if (strcmp(var_name, list_ptr->next->var_name) == 0) {
-                    int def_index = list_ptr->next->definition_index;
-                    DeadVarsList *next_next_ptr = list_ptr->next->next;
-                    free(list_ptr->next->var_name);
-                    free(list_ptr->next);
-                    list_ptr->next = next_next_ptr;
-                    return def_index;
-                }
-                else {
-                    list_ptr = list_ptr->next;
-                    index++;
-                }
-            }
-        }
-    }
-    return -1;
+/* Variables live at exit. The partitions run one after another on the same
+ variables, so only at the end of the last one does a set given with -live= hold.
+ Otherwise every variable the partition uses is live at its exit, as the next
+ partition or the end of the program may read it; a variable the partition does not
+ use keeps its value through it, so it need not be in the set. The temporaries the
+ passes create (see internTemporarySymbol()) are not live: a temporary that CSE
+ introduced is removed once nothing reads it. Labels and function names are not
+ variables. */
+void clearLiveAtExit() {
+    freeIntSet(live_at_exit);
+    live_at_exit = makeEmptyIntSet();
+    live_at_exit_given = 1;
 }
 
-// Mark the dead variable as 'REMOVED' in the quadruples queue and removes it from the dead variables list
-void removeDeadVariable(char *var_name) {
-    DeadVarsList *list_ptr = dead_variables;
-    if (list_ptr != NULL) {
-        // First element of the list
-        if (strcmp(var_name, list_ptr->var_name) == 0) {
-            removeQuadrupleFromQueueWithIndex(list_ptr->definition_index);
-            dead_variables = dead_variables->next;
-            free(list_ptr->var_name);
-            free(list_ptr);
-        }
-        else {
-            int found = 0;
-            while (list_ptr->next != NULL && found != 1) {
-                if (strcmp(var_name, list_ptr->next->var_name) == 0) {
-                    found = 1;
-                    int quadruple_queue_index = list_ptr->next->definition_index;
-                    removeQuadrupleFromQueueWithIndex(quadruple_queue_index);
-                    DeadVarsList *next_next_ptr = list_ptr->next->next;
-                    free(list_ptr->next->var_name);
-                    free(list_ptr->next);
-                    list_ptr->next = next_next_ptr;
-                }
-                else {
-                    list_ptr = list_ptr->next;
-                }
-            }
-        }
+void addLiveAtExitVariable(symbolId var) {
+    if (!live_at_exit_given) {
+        clearLiveAtExit();
     }
+    insertIntSet(var, &live_at_exit);
 }
 
-// This function gets the two quadruples and substitute them for one of the type lhs = rhs.
-// The quadruple corresponding to the rhs is removed from the quadrupleQueue.
-void consolidateQuadruplesInQuadQueue(int lhs_index, int rhs_index) {
-    quadrupleQueue *lhs_quad_queue = getQuadrupleQueuePtrFromIndex(lhs_index);
-    quadrupleQueue *rhs_quad_queue = getQuadrupleQueuePtrFromIndex(rhs_index);
-
-    if (lhs_quad_queue != NULL && rhs_quad_queue != NULL) {
-        if (getUsesCount(rhs_quad_queue->quad->lhs) == 1) {
-            lhs_quad_queue->quad->operation = rhs_quad_queue->quad->operation;
-            lhs_quad_queue->quad->operand1 = stringDuplicate(rhs_quad_queue->quad->operand1);
-            if (rhs_quad_queue->quad->operation != ASSIGNMENT) {
-                lhs_quad_queue->quad->operand2 = stringDuplicate(rhs_quad_queue->quad->operand2);
-            }
-
-            removeQuadrupleFromQueueWithIndex(rhs_index);
-        }
-    }
-    else {
-        fprintf(stderr, "Error: invalid indexes on consolidateQuadruplesInQuadQueue()!\n");
-        exit(EXIT_FAILURE);
+intSet getLiveAtExit() {
+    if (live_at_exit_given && getOptimizerContext()->ends_program) {
+        return copyIntSet(live_at_exit);
     }
-
-}
-
-void destroyDeadVarsList() {
-    DeadVarsList *list_ptr = dead_variables;
-
-    while (list_ptr != NULL) {
-        dead_variables = list_ptr->next;
-        free(list_ptr->var_name);
-        free(list_ptr);
-        list_ptr = dead_variables;
+    int count = getPartitionSymbolCount();
+    symbolId *symbols = getPartitionSymbols();
+    char *is_temporary = safeMalloc(count + 1);
+    char *is_label = safeMalloc(count + 1);
+    intSet live = makeEmptyIntSet();
+    int i;
+
+    classifySymbols(symbols, count, is_temporary, is_label);
+    for (i = 0; i < count; i++) {
+        if (!is_temporary[i] && !is_label[i]) {
+            insertIntSet(symbols[i], &live);
+        }
     }
+    free(is_label);
+    free(is_temporary);
+    return live;
 }
 
-void runRedundancyConsolidation() {
-    // Redundancy consolidation uses the dead variables list without actually deleting any code.
-    initializeVarCountTable();
-    initializeDeadVarsList();
-    quadrupleQueue *quad_queue = getQuadrupleQueuePointer();
-    int index = 0;
-
-    while (quad_queue != NULL) {
-        if (quad_queue->removed_quadruple == 0) {
-            resetUsesCount(quad_queue->quad->lhs, 0);
-            insertDeadVariable(quad_queue->quad->lhs, index);
-            if (quad_queue->quad->operation == ASSIGNMENT) {
-                int operand_index = resurrectVariable(quad_queue->quad->operand1);
-                quad_queue->rhs_index_consolidation = operand_index;
-                incrementUsesCount(quad_queue->quad->operand1);
-            }
-            else {
-                resurrectVariable(quad_queue->quad->operand1);
-                resurrectVariable(quad_queue->quad->operand2);
-                incrementUsesCount(quad_queue->quad->operand1);
-                incrementUsesCount(quad_queue->quad->operand2);
-            }
+/* Mark what is needed: the jumps and labels, the definitions that reach the exit
+ live, and then through the chains every definition an operand of a needed
+ quadruple reads, in whatever block. What is left unmarked is dead or faint, only
+ read by code that goes as well, also around a loop, and is removed in one sweep
+ that keeps the use counts of the chains exact. */
+void runDeadCodeElimination() {
+    defUseChains *chains = getDefUseChains();
+    int size = getQuadrupleQueueSize();
+    char *needed = safeMalloc(size + 1);
+    int *worklist = safeMalloc((size + 1) * sizeof(int));
+    int count = 0;
+    int index, operand_number, i;
+
+    for (index = 0; index < size; index++) {
+        quadrupleEntry *entry = getQuadrupleEntry(index);
+        needed[index] = (entry->removed_quadruple == 0 &&
+                         (!definesVariable(entry->quad) || isLiveAtExitDefinition(chains, index)));
+        if (needed[index]) {
+            worklist[count++] = index;
         }
-
-        index++;
-        quad_queue = quad_queue->next;
     }
-
-    // Run the consolidation to remove redundant assignments
-    quad_queue = getQuadrupleQueuePointer();
-    index = 0;
-    while (quad_queue != NULL) {
-        if (quad_queue->removed_quadruple == 0) {
-            int consolidation_index = quad_queue->rhs_index_consolidation;
-            if (consolidation_index != -1) {
-                consolidateQuadruplesInQuadQueue(index, consolidation_index);
+    while (count > 0) {
+        index = worklist[--count];
+        for (operand_number = 1; operand_number <= 2; operand_number++) {
+            int *definitions;
+            int n = getReachingDefinitions(chains, index, operand_number, &definitions);
+            for (i = 0; i < n; i++) {
+                if (!needed[definitions[i]]) {
+                    needed[definitions[i]] = 1;
+                    worklist[count++] = definitions[i];
+                }
             }
         }
-        quad_queue = quad_queue->next;
-        index++;
     }
-
-    destroyDeadVarsList();
-    destroyVarCountTable();
-}
-
-void runDeadCodeElimination() {
-    runRedundancyConsolidation();
-
-    int removal_count = -1;
-    while (removal_count != 0) {
-        removal_count = 0;
-        // Run the dead code elimination until the code stabilizes
-
-        initializeDeadVarsList();
-        quadrupleQueue *quad_queue = getQuadrupleQueuePointer();
-        int index = 0;
-
-        while (quad_queue != NULL) {
-            if (quad_queue->removed_quadruple == 0) {
-                if (lookupDeadVariable(quad_queue->quad->lhs) != -1) {
-                    // If the left hand side is marked as dead, remove it from the original code
-                    removeDeadVariable(quad_queue->quad->lhs);
-                    removal_count++;
-                }
-                insertDeadVariable(quad_queue->quad->lhs, index);
-                if (quad_queue->quad->operation == ASSIGNMENT) {
-                    resurrectVariable(quad_queue->quad->operand1);
-                }
-                else {
-                    resurrectVariable(quad_queue->quad->operand1);
-                    resurrectVariable(quad_queue->quad->operand2);
-                }
-            }
-
-            quad_queue = quad_queue->next;
-            index++;
+    for (index = 0; index < size; index++) {
+        if (getQuadrupleEntry(index)->removed_quadruple == 0 && !needed[index]) {
+            removeDefinition(chains, index);
         }
-        destroyDeadVarsList();
     }
+
+    free(worklist);
+    free(needed);
+    /* Compaction moves the quadruples, so the chains go with it. */
+    discardDefUseChains();
+    compactQuadrupleQueue();
 }
@@ -1,20 +1,13 @@
 #ifndef DEADCODE_H
 #define DEADCODE_H
 
-typedef struct DeadVarsList {
-    char *var_name;
-    int definition_index;
-    
-    struct DeadVarsList *next;
-} DeadVarsList;
+#include <stdio.h>
+#include "symtab.h"
+#include "intset.h"
 
-void initializeDeadVarsList();
-void insertDeadVariable(char *var_name, int definition_index);
-int lookupDeadVariable(char *var_name);
-int resurrectVariable(char *var_name);
-void removeDeadVariable(char *var_name);
-void consolidateQuadruplesInQuadQueue(int lhs_index, int rhs_index);
-void destroyDeadVarsList();
+void clearLiveAtExit();
+void addLiveAtExitVariable(symbolId var);
+intSet getLiveAtExit();
 
 void runRedundancyConsolidation();
 void runDeadCodeElimination();
@@ -0,0 +1,343 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "misc.h"
+#include "quadruple.h"
+#include "context.h"
+#include "cfg.h"
+#include "dataflow.h"
+#include "deadcode.h"
+#include "defuse.h"
+
+static defUseChains *allocateDefUseChains(int size) {
+    defUseChains *chains = safeMalloc(sizeof(defUseChains));
+    chains->operand1_first = safeMalloc(size * sizeof(int));
+    chains->operand1_count = safeMalloc(size * sizeof(int));
+    chains->operand2_first = safeMalloc(size * sizeof(int));
+    chains->operand2_count = safeMalloc(size * sizeof(int));
+    chains->reaching_capacity = 2 * size + 1;
+    chains->reaching = safeMalloc(chains->reaching_capacity * sizeof(int));
+    chains->reaching_size = 0;
+    chains->block = safeMalloc(size * sizeof(int));
+    chains->operand1_killed_at = safeMalloc(size * sizeof(int));
+    chains->operand2_killed_at = safeMalloc(size * sizeof(int));
+    chains->killed_at = safeMalloc(size * sizeof(int));
+    chains->use_count = safeMalloc(size * sizeof(int));
+    chains->live_at_exit = safeMalloc(size * sizeof(char));
+    chains->size = size;
+    return chains;
+}
+
+// Makes room for count more linked definitions and returns where they start.
+static int reserveReaching(defUseChains *chains, int count) {
+    int first = chains->reaching_size;
+    while (chains->reaching_size + count > chains->reaching_capacity) {
+        chains->reaching_capacity *= 2;
+        chains->reaching = safeRealloc(chains->reaching, chains->reaching_capacity * sizeof(int));
+    }
+    chains->reaching_size += count;
+    return first;
+}
+
+/* What building the chains needs per variable, indexed by getPartitionSymbolIndex().
+ The last definition seen of each
+ variable, and each variable read before it is defined in a block, are stamped with
+ the block, so nothing has to be cleared between blocks. */
+typedef struct chainBuild {
+    int *definition;
+    int *stamp;
+    int *exposed_stamp;
+    int *exposed_first;         /* where the reaching definitions of an exposed variable start */
+    int *exposed_count;
+    int *exposed;               /* the variables the current block reads before defining them */
+    int exposed_size;
+    int *definitions_start;     /* the facts of computeReachingDefinitions() */
+    int *definitions;
+} chainBuild;
+
+/* Links a read of op in block b to the definition before it in the block. A read
+ of a variable not defined yet in the block gets the variable in first and a count
+ of -1, and is linked once the reaching definitions of the block are sorted out. */
+static void linkOperand(defUseChains *chains, chainBuild *build, operand op, int *first, int *count, int b) {
+    if (op.kind != VARIABLE_OPERAND) {
+        *first = *count = 0;
+        return;
+    }
+    int var = getPartitionSymbolIndex(op.value);
+    if (build->stamp[var] == b) {
+        *first = reserveReaching(chains, 1);
+        chains->reaching[*first] = build->definition[var];
+        *count = 1;
+    } else {
+        *first = var;
+        *count = -1;
+        if (build->exposed_stamp[var] != b) {
+            build->exposed_stamp[var] = b;
+            build->exposed[build->exposed_size++] = var;
+        }
+    }
+}
+
+static void linkExposedOperand(chainBuild *build, int *first, int *count) {
+    if (*count == -1) {
+        *count = build->exposed_count[*first];
+        *first = build->exposed_first[*first];
+    }
+}
+
+/* The reads of an exposed variable share the definitions of that variable that are
+ in reaching_in. Those are numbered together, so only their range is looked at. */
+static void linkExposedVariables(defUseChains *chains, chainBuild *build, intSet reaching_in) {
+    int i, n, slot;
+
+    for (i = 0; i < build->exposed_size; i++) {
+        int var = build->exposed[i];
+        int end = build->definitions_start[var + 1];
+        build->exposed_first[var] = chains->reaching_size;
+        for (n = nextMemberIntSet(reaching_in, build->definitions_start[var]); n != -1 && n < end;
+             n = nextMemberIntSet(reaching_in, n + 1)) {
+            slot = reserveReaching(chains, 1);
+            chains->reaching[slot] = build->definitions[n];
+        }
+        build->exposed_count[var] = chains->reaching_size - build->exposed_first[var];
+    }
+    build->exposed_size = 0;
+}
+
+static int operandKilledAt(operand op, int *next_definition, int *stamp, int b, int end) {
+    if (op.kind != VARIABLE_OPERAND) {
+        return end;
+    }
+    int var = getPartitionSymbolIndex(op.value);
+    return (stamp[var] == b ? next_definition[var] : end);
+}
+
+static void countUses(defUseChains *chains, int first, int count) {
+    int i;
+    for (i = first; i < first + count; i++) {
+        chains->use_count[chains->reaching[i]]++;
+    }
+}
+
+/* Each block is walked forwards to link the reads to the definitions before them,
+ and the reads of a variable not defined yet to the reaching definitions at the
+ start of the block; it is walked backwards to find where each value is killed. */
+static defUseChains *buildDefUseChains() {
+    controlFlowGraph *cfg = buildControlFlowGraph();
+    intSet live_at_exit = getLiveAtExit();
+    chainBuild build;
+    dataflowSolution reaching = computeReachingDefinitions(cfg, &build.definitions_start, &build.definitions);
+    int size = getQuadrupleQueueSize();
+    int symbol_count = getPartitionSymbolCount();
+    defUseChains *chains = allocateDefUseChains(size);
+    int index, var, b, n;
+
+    build.definition = safeMalloc((symbol_count + 1) * sizeof(int));
+    build.stamp = safeMalloc((symbol_count + 1) * sizeof(int));
+    build.exposed_stamp = safeMalloc((symbol_count + 1) * sizeof(int));
+    build.exposed_first = safeMalloc((symbol_count + 1) * sizeof(int));
+    build.exposed_count = safeMalloc((symbol_count + 1) * sizeof(int));
+    build.exposed = safeMalloc((symbol_count + 1) * sizeof(int));
+    build.exposed_size = 0;
+
+    for (var = 0; var < symbol_count; var++) {
+        build.stamp[var] = build.exposed_stamp[var] = -1;
+    }
+    for (index = 0; index < size; index++) {
+        chains->operand1_count[index] = chains->operand2_count[index] = 0;
+        chains->use_count[index] = 0;
+        chains->live_at_exit[index] = 0;
+    }
+    for (b = 0; b < cfg->block_count; b++) {
+        basicBlock *block = &cfg->blocks[b];
+        for (index = block->first; index < block->last; index++) {
+            quadrupleEntry *entry = getQuadrupleEntry(index);
+            chains->block[index] = b;
+            if (entry->removed_quadruple) {
+                continue;
+            }
+            linkOperand(chains, &build, entry->quad.operand1,
+                        &chains->operand1_first[index], &chains->operand1_count[index], b);
+            linkOperand(chains, &build, entry->quad.operand2,
+                        &chains->operand2_first[index], &chains->operand2_count[index], b);
+            if (definesVariable(entry->quad)) {
+                var = getPartitionSymbolIndex(entry->quad.lhs);
+                build.definition[var] = index;
+                build.stamp[var] = b;
+            }
+        }
+        linkExposedVariables(chains, &build, reaching.in[b]);
+        for (index = block->first; index < block->last; index++) {
+            linkExposedOperand(&build, &chains->operand1_first[index], &chains->operand1_count[index]);
+            linkExposedOperand(&build, &chains->operand2_first[index], &chains->operand2_count[index]);
+        }
+    }
+
+    for (var = 0; var < symbol_count; var++) {
+        build.stamp[var] = -1;
+    }
+    for (b = 0; b < cfg->block_count; b++) {
+        basicBlock *block = &cfg->blocks[b];
+        for (index = block->last - 1; index >= block->first; index--) {
+            quadrupleEntry *entry = getQuadrupleEntry(index);
+            if (entry->removed_quadruple) {
+                continue;
+            }
+            // A quadruple reads its operands before it defines its lhs.
+            if (definesVariable(entry->quad)) {
+                int lhs = getPartitionSymbolIndex(entry->quad.lhs);
+                chains->killed_at[index] = (build.stamp[lhs] == b ? build.definition[lhs] : block->last);
+                build.definition[lhs] = index;
+                build.stamp[lhs] = b;
+            }
+            chains->operand1_killed_at[index] =
+                operandKilledAt(entry->quad.operand1, build.definition, build.stamp, b, block->last);
+            chains->operand2_killed_at[index] =
+                operandKilledAt(entry->quad.operand2, build.definition, build.stamp, b, block->last);
+            countUses(chains, chains->operand1_first[index], chains->operand1_count[index]);
+            countUses(chains, chains->operand2_first[index], chains->operand2_count[index]);
+        }
+        if (block->falls_to_exit) {
+            for (n = nextMemberIntSet(reaching.out[b], 0); n != -1; n = nextMemberIntSet(reaching.out[b], n + 1)) {
+                int definition = build.definitions[n];
+                if (isMemberIntSet(getQuadrupleEntry(definition)->quad.lhs, live_at_exit)) {
+                    chains->live_at_exit[definition] = 1;
+                }
+            }
+        }
+    }
+
+    chains->queue_version = getOptimizerContext()->queue.version;
+    free(build.definitions);
+    free(build.definitions_start);
+    free(build.exposed);
+    free(build.exposed_count);
+    free(build.exposed_first);
+    free(build.exposed_stamp);
+    free(build.stamp);
+    free(build.definition);
+    freeDataflowSolution(reaching);
+    freeIntSet(live_at_exit);
+    destroyControlFlowGraph(cfg);
+    return chains;
+}
+
+defUseChains *getDefUseChains() {
+    optimizerContext *context = getOptimizerContext();
+    if (context->def_use != NULL && context->def_use->queue_version != context->queue.version) {
+        discardDefUseChains();
+    }
+    if (context->def_use == NULL) {
+        context->def_use = buildDefUseChains();
+    }
+    return context->def_use;
+}
+
+/* The definitions that reach operand operand_number (1 or 2) of the quadruple at
+ index: their count is returned and *definitions points at them. */
+int getReachingDefinitions(defUseChains *chains, int index, int operand_number, int **definitions) {
+    if (operand_number == 1) {
+        *definitions = chains->reaching + chains->operand1_first[index];
+        return chains->operand1_count[index];
+    }
+    *definitions = chains->reaching + chains->operand2_first[index];
+    return chains->operand2_count[index];
+}
+
+// The one definition the operand reads, or NO_DEFINITION if none or several reach it.
+int getOperandDefinition(defUseChains *chains, int index, int operand_number) {
+    int *definitions;
+    if (getReachingDefinitions(chains, index, operand_number, &definitions) != 1) {
+        return NO_DEFINITION;
+    }
+    return definitions[0];
+}
+
+int getUseCount(defUseChains *chains, int definition) {
+    return chains->use_count[definition];
+}
+
+int isLiveAtExitDefinition(defUseChains *chains, int definition) {
+    return chains->live_at_exit[definition];
+}
+
+int isUsedDefinition(defUseChains *chains, int definition) {
+    return chains->use_count[definition] > 0 || chains->live_at_exit[definition];
+}
+
+/* Whether the operands of the quadruple at index still hold the same values at
+ position, later in the same block. The quadruple at position may redefine one:
+ it reads its operands first. */
+int holdsOperandValues(defUseChains *chains, int index, int position) {
+    return chains->block[index] == chains->block[position] &&
+           chains->operand1_killed_at[index] >= position && chains->operand2_killed_at[index] >= position;
+}
+
+static void syncQueueVersion(defUseChains *chains) {
+    chains->queue_version = getOptimizerContext()->queue.version;
+}
+
+static void dropUses(defUseChains *chains, int first, int count) {
+    int i;
+    for (i = first; i < first + count; i++) {
+        chains->use_count[chains->reaching[i]]--;
+    }
+}
+
+/* Removes a definition whose value is not used, or only by quadruples that are
+ removed as well; every definition its operands read loses a use. */
+void removeDefinition(defUseChains *chains, int definition) {
+    dropUses(chains, chains->operand1_first[definition], chains->operand1_count[definition]);
+    dropUses(chains, chains->operand2_first[definition], chains->operand2_count[definition]);
+    removeQuadrupleFromQueueWithIndex(definition);
+    syncQueueVersion(chains);
+}
+
+static int copyKilledAt(defUseChains *chains, int killed_at, int copy) {
+    return (killed_at == copy ? chains->killed_at[copy] : killed_at);
+}
+
+/* Turns the copy x = t into x = <the expression of t> and removes the definition
+ of t. The caller checks that the copy is its only use, that t does not reach the
+ exit live and that holdsOperandValues(definition, copy): the reads then move to
+ the copy and keep their definitions. An operand the copy itself redefines is
+ killed where the copy's own value is. */
+void replaceCopyWithDefinition(defUseChains *chains, int copy) {
+    int definition = getOperandDefinition(chains, copy, 1);
+    quadruple *copy_quad = &getQuadrupleEntry(copy)->quad;
+    quadruple *definition_quad = &getQuadrupleEntry(definition)->quad;
+
+    copy_quad->operation = definition_quad->operation;
+    copy_quad->operand1 = definition_quad->operand1;
+    copy_quad->operand2 = definition_quad->operand2;
+    chains->operand1_first[copy] = chains->operand1_first[definition];
+    chains->operand1_count[copy] = chains->operand1_count[definition];
+    chains->operand2_first[copy] = chains->operand2_first[definition];
+    chains->operand2_count[copy] = chains->operand2_count[definition];
+    chains->operand1_killed_at[copy] = copyKilledAt(chains, chains->operand1_killed_at[definition], copy);
+    chains->operand2_killed_at[copy] = copyKilledAt(chains, chains->operand2_killed_at[definition], copy);
+
+    chains->use_count[definition] = 0;
+    removeQuadrupleFromQueueWithIndex(definition);
+    syncQueueVersion(chains);
+}
+
+void discardDefUseChains() {
+    optimizerContext *context = getOptimizerContext();
+    defUseChains *chains = context->def_use;
+    if (chains == NULL) {
+        return;
+    }
+    free(chains->operand1_first);
+    free(chains->operand1_count);
+    free(chains->operand2_first);
+    free(chains->operand2_count);
+    free(chains->reaching);
+    free(chains->block);
+    free(chains->operand1_killed_at);
+    free(chains->operand2_killed_at);
+    free(chains->killed_at);
+    free(chains->use_count);
+    free(chains->live_at_exit);
+    free(chains);
+    context->def_use = NULL;
+}
@@ -0,0 +1,48 @@
+#ifndef DEFUSE_H
+#define DEFUSE_H
+
+/* Def-use chains over the queue of the current context. Every variable operand is
+ linked to the definitions that reach it: the one before it in its block, or else
+ the reaching definitions of its variable at the start of the block, in any block.
+ Every definition counts the reads linked to it over the whole partition and knows
+ whether it reaches the exit with its variable live there. Which quadruples compute
+ an operand, and whether a definition is used, are then answered without a search.
+
+ The chains are built with one reaching definitions analysis and one pass over the
+ queue when a pass first asks for them, and kept in the context. The functions
+ below rewrite the queue and keep the chains exact: removing a definition takes a
+ use from every definition its operands read, whatever block those are in. Any
+ other insertion, removal or compaction makes getDefUseChains() build them again. */
+
+#define NO_DEFINITION (-1)
+
+typedef struct defUseChains {
+    int *operand1_first;       /* per quadruple: where the definitions it reads start in reaching */
+    int *operand1_count;       /* per quadruple: how many there are */
+    int *operand2_first;
+    int *operand2_count;
+    int *reaching;             /* the linked definitions; reads at the start of a block share them */
+    int reaching_size;
+    int reaching_capacity;
+    int *block;                /* per quadruple: its basic block */
+    int *operand1_killed_at;   /* per quadruple: the next definition of the variable read, or the end of the block */
+    int *operand2_killed_at;
+    int *killed_at;            /* per definition: the next definition of its lhs, or the end of the block */
+    int *use_count;            /* per definition */
+    char *live_at_exit;        /* per definition */
+    int size;
+    int queue_version;         /* the version of the queue the chains describe */
+} defUseChains;
+
+defUseChains *getDefUseChains();
+int getReachingDefinitions(defUseChains *chains, int index, int operand_number, int **definitions);
+int getOperandDefinition(defUseChains *chains, int index, int operand_number);
+int getUseCount(defUseChains *chains, int definition);
+int isLiveAtExitDefinition(defUseChains *chains, int definition);
+int isUsedDefinition(defUseChains *chains, int definition);
+int holdsOperandValues(defUseChains *chains, int index, int position);
+void removeDefinition(defUseChains *chains, int definition);
+void replaceCopyWithDefinition(defUseChains *chains, int copy);
+void discardDefUseChains();
+
+#endif
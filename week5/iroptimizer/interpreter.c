@@ -0,0 +1,222 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "misc.h"
+#include "quadruple.h"
+#include "interpreter.h"
+
+/* An instruction refers to its operands by register: the registers below
+ symbol_count are the variables, the ones above hold the constants of the program.
+ Labels and function markers are not instructions; a jump holds the index of the
+ instruction after its label in lhs. */
+typedef struct instruction {
+    operator operation;
+    int lhs;
+    int operand1, operand2;
+} instruction;
+
+typedef struct program {
+    instruction *instructions;
+    int size, allocated_size;
+    constantValue *registers;
+    int register_count, registers_allocated_size;
+} program;
+
+static symbolId *input_variables = NULL;
+static constantValue *input_values = NULL;
+static int input_count = 0;
+static int input_allocated_size = 0;
+static int profile = 0;
+
+// Sets the value variable has when the program starts (-input=).
+void setInputValue(symbolId variable, constantValue value) {
+    if (input_count == input_allocated_size) {
+        input_allocated_size = (input_allocated_size == 0 ? 16 : 2 * input_allocated_size);
+        input_variables = safeRealloc(input_variables, input_allocated_size * sizeof(symbolId));
+        input_values = safeRealloc(input_values, input_allocated_size * sizeof(constantValue));
+    }
+    input_variables[input_count] = variable;
+    input_values[input_count++] = value;
+}
+
+void enableInterpreterProfile() {
+    profile = 1;
+}
+
+// A missing operand is never read, so any register will do for it.
+static int operandRegister(program *p, operand op) {
+    if (op.kind != CONSTANT_OPERAND) {
+        return (op.kind == VARIABLE_OPERAND ? op.value : 0);
+    }
+    if (p->register_count == p->registers_allocated_size) {
+        p->registers_allocated_size *= 2;
+        p->registers = safeRealloc(p->registers, p->registers_allocated_size * sizeof(constantValue));
+    }
+    p->registers[p->register_count] = op.value;
+    return p->register_count++;
+}
+
+static void appendInstruction(program *p, operator operation, int lhs, int operand1, int operand2) {
+    if (p->size == p->allocated_size) {
+        p->allocated_size = (p->allocated_size == 0 ? 1024 : 2 * p->allocated_size);
+        p->instructions = safeRealloc(p->instructions, p->allocated_size * sizeof(instruction));
+    }
+    p->instructions[p->size].operation = operation;
+    p->instructions[p->size].lhs = lhs;
+    p->instructions[p->size].operand1 = operand1;
+    p->instructions[p->size].operand2 = operand2;
+    p->size++;
+}
+
+/* Appends the queue of the current context to p. A label is found first, so its
+ jumps can be resolved as they are appended; label_index is left all -1 again. */
+static void translatePartition(program *p, int *label_index) {
+    int size = getQuadrupleQueueSize();
+    int i, next = p->size;
+
+    for (i = 0; i < size; i++) {
+        quadrupleEntry *entry = getQuadrupleEntry(i);
+        if (entry->removed_quadruple) {
+            continue;
+        }
+        if (entry->quad.operation == LABELOP) {
+            label_index[entry->quad.lhs] = next;
+        }
+        else if (entry->quad.operation != FUNCTIONOP) {
+            next++;
+        }
+    }
+
+    for (i = 0; i < size; i++) {
+        quadrupleEntry *entry = getQuadrupleEntry(i);
+        quadruple quad = entry->quad;
+        if (entry->removed_quadruple || quad.operation == LABELOP || quad.operation == FUNCTIONOP) {
+            continue;
+        }
+        if (isJump(quad)) {
+            if (label_index[quad.lhs] == -1) {
+                abortMessage("Error: label [%s] is not defined.", getSymbolName(quad.lhs));
+            }
+            appendInstruction(p, quad.operation, label_index[quad.lhs], operandRegister(p, quad.operand1), 0);
+        }
+        else {
+            appendInstruction(p, quad.operation, quad.lhs, operandRegister(p, quad.operand1),
+                              operandRegister(p, quad.operand2));
+        }
+    }
+
+    for (i = 0; i < size; i++) {
+        quadrupleEntry *entry = getQuadrupleEntry(i);
+        if (entry->quad.operation == LABELOP) {
+            label_index[entry->quad.lhs] = -1;
+        }
+    }
+}
+
+/* The dispatch loop. Returns the number of instructions executed; counts[op] gets
+ the number per operator. */
+static long execute(program *p, long *counts) {
+    instruction *code = p->instructions;
+    constantValue *r = p->registers;
+    int pc = 0, size = p->size, op;
+    long executed = 0;
+
+    while (pc < size) {
+        instruction *in = &code[pc++];
+        counts[in->operation]++;
+        switch (in->operation) {
+            case ASSIGNMENT:
+                r[in->lhs] = r[in->operand1];
+                break;
+            case GOTOOP:
+                pc = in->lhs;
+                break;
+            case IFGOTOOP:
+                if (r[in->operand1] != 0) {
+                    pc = in->lhs;
+                }
+                break;
+            default:
+                r[in->lhs] = calculateOperation(in->operation, r[in->operand1], r[in->operand2]);
+                break;
+        }
+    }
+    for (op = 0; op <= FUNCTIONOP; op++) {
+        executed += counts[op];
+    }
+    return executed;
+}
+
+static int compareSymbolNames(const void *a, const void *b) {
+    return strcmp(getSymbolName(*(const symbolId *)a), getSymbolName(*(const symbolId *)b));
+}
+
+static double now() {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+static void fprintfProfile(FILE *f, program *p, long executed, long *counts, double seconds) {
+    static char *operator_names[] = {"=", "+", "-", "*", "/", "<<", ">>", "label", "goto", "if goto", "function"};
+    int op;
+
+    fprintf(f, "executed %ld quadruples of %d in %.4f s (%.1f million per second)\n", executed, p->size, seconds,
+            (seconds > 0.0 ? executed / seconds / 1e6 : 0.0));
+    for (op = 0; op <= FUNCTIONOP; op++) {
+        if (counts[op] > 0) {
+            fprintf(f, "  %-8s %12ld\n", operator_names[op], counts[op]);
+        }
+    }
+}
+
+void interpretProgram(FILE *f, optimizerContext **contexts, int context_count) {
+    int symbol_count = getSymbolCount();
+    int *label_index = safeMalloc((symbol_count + 1) * sizeof(int));
+    symbolId *order = safeMalloc((symbol_count + 1) * sizeof(symbolId));
+    long counts[FUNCTIONOP + 1];
+    program p;
+    int c, var, count = 0;
+
+    p.instructions = NULL;
+    p.size = p.allocated_size = 0;
+    p.register_count = symbol_count;
+    p.registers_allocated_size = 2 * symbol_count + 16;
+    p.registers = safeMalloc(p.registers_allocated_size * sizeof(constantValue));
+    for (var = 0; var < symbol_count; var++) {
+        p.registers[var] = 0;
+        label_index[var] = -1;
+    }
+    for (c = 0; c < input_count; c++) {
+        p.registers[input_variables[c]] = wrapConstant(input_values[c]);
+    }
+    for (c = 0; c < context_count; c++) {
+        setOptimizerContext(contexts[c]);
+        translatePartition(&p, label_index);
+    }
+    for (c = 0; c <= FUNCTIONOP; c++) {
+        counts[c] = 0;
+    }
+
+    double start = now();
+    long executed = execute(&p, counts);
+    if (profile) {
+        fprintfProfile(stderr, &p, executed, counts, now() - start);
+    }
+
+    for (var = 0; var < symbol_count; var++) {
+        if (p.registers[var] != 0 && getSymbolName(var)[0] != '_') {
+            order[count++] = var;
+        }
+    }
+    qsort(order, count, sizeof(symbolId), compareSymbolNames);
+    for (var = 0; var < count; var++) {
+        fprintf(f, "%s = %lld\n", getSymbolName(order[var]), p.registers[order[var]]);
+    }
+
+    free(order);
+    free(label_index);
+    free(p.registers);
+    free(p.instructions);
+}
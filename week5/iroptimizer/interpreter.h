@@ -0,0 +1,25 @@
+#ifndef INTERPRETER_H
+#define INTERPRETER_H
+
+#include <stdio.h>
+#include "context.h"
+
+/* Runs the program instead of printing it (-run), to check that the optimized
+ program computes what the original does. The partitions run one after another on
+ one set of variables, which start at 0 unless -input=var=value,... gives a value;
+ a jump goes to the label in its own partition. Arithmetic is that of
+ calculateOperation(), on words of the size -wordsize= sets. At the end the variables that are not temporaries and are
+ not 0 are printed as "name = value", sorted by name, so two programs that compute
+ the same give the same output.
+
+ The queues are first translated to an array of instructions whose operands are
+ indices into one array of registers, the variables by symbol id and then the
+ constants, and whose jumps hold the index they go to. The dispatch loop then does
+ no lookups at all. With -profile the number of quadruples executed, per operator,
+ and the time taken are printed to stderr. */
+
+void setInputValue(symbolId variable, constantValue value);
+void enableInterpreterProfile();
+void interpretProgram(FILE *f, optimizerContext **contexts, int context_count);
+
+#endif
@@ -9,9 +9,16 @@
     extern void processQuadruple(quadruple q);
     
     /* some global variables, but statically declared (so safe) */
-    char *lhs, *operand1, *operand2;
+    symbolId lhs, label;
+    operand operand1, operand2;
     operator op;
     
+    /* A constant with a minus sign, as fprintfOperand() prints a negative one. The
+     digits are read unsigned, so the smallest 64-bit word reads back as itself. */
+    constantValue negativeConstant(const char *digits) {
+        return (constantValue)(0 - strtoull(digits, NULL, 10));
+    }
+    
     int yyerror(const char *s) {
         showLine(1);
         printf("%s\n",s);
@@ -23,44 +30,61 @@
 /* Bison declarations.  */
 /* %define parse.error verbose */
 %token IDENTIFIER EQUALS INTCONSTANT SEMICOLON
-%token PLUS MINUS TIMES DIV
+%token PLUS MINUS TIMES DIV SHIFTLEFT SHIFTRIGHT
+%token COLON GOTO IF FUNCTION
 
 %start IRgrammar
 
 
 %%  /****** grammar rules section ********/
 
-IRgrammar : Line IRgrammar
+/* Left recursive, so the parser stack stays flat however long the program is. */
+IRgrammar : IRgrammar Line
 | /* empty */
 ;
 
 Line      : Lhs EQUALS Rhs
 { quadruple q = makeQuadruple(lhs, op, operand1, operand2);
     processQuadruple(q);
-    free(lhs);
-    free(operand1);
-    free(operand2);
 }
 SEMICOLON
+| Lhs COLON
+{ processQuadruple(makeQuadruple(lhs, LABELOP, makeNoOperand(), makeNoOperand())); }
+| GOTO Label SEMICOLON
+{ processQuadruple(makeQuadruple(label, GOTOOP, makeNoOperand(), makeNoOperand())); }
+| IF Operand1 GOTO Label SEMICOLON
+{ processQuadruple(makeQuadruple(label, IFGOTOOP, operand1, makeNoOperand())); }
+| FUNCTION Label COLON
+{ processQuadruple(makeQuadruple(label, FUNCTIONOP, makeNoOperand(), makeNoOperand())); }
+;
+
+Label     : IDENTIFIER { label = internSymbol(yytext); }
 ;
 
-Lhs       : IDENTIFIER { lhs = stringDuplicate(yytext); }
+/* Names are interned and constants converted as soon as they are scanned. A label
+ definition also starts with Lhs: with a rule of its own, the parser would need the
+ next token to choose, and yytext would no longer hold the name. */
+Lhs       : IDENTIFIER { lhs = internSymbol(yytext); }
 ;
 
-Rhs       : Operand1 { op = ASSIGNMENT; operand2 = NULL; }
+Rhs       : Operand1 { op = ASSIGNMENT; operand2 = makeNoOperand(); }
 | Operand1 Operator Operand2
 ;
 
-Operand1  : IDENTIFIER  { operand1 = stringDuplicate(yytext); }
-| INTCONSTANT { operand1 = stringDuplicate(yytext); }
+Operand1  : IDENTIFIER  { operand1 = makeVariableOperand(internSymbol(yytext)); }
+| INTCONSTANT { operand1 = makeConstantOperand(atoll(yytext)); }
+| MINUS INTCONSTANT { operand1 = makeConstantOperand(negativeConstant(yytext)); }
 ;
 
-Operand2  : IDENTIFIER  { operand2 = stringDuplicate(yytext); }
-| INTCONSTANT { operand2 = stringDuplicate(yytext); }
+Operand2  : IDENTIFIER  { operand2 = makeVariableOperand(internSymbol(yytext)); }
+| INTCONSTANT { operand2 = makeConstantOperand(atoll(yytext)); }
+| MINUS INTCONSTANT { operand2 = makeConstantOperand(negativeConstant(yytext)); }
 ;
 
 Operator  : PLUS  { op = PLUSOP;  }
 | MINUS { op = MINUSOP; }
 | TIMES { op = TIMESOP; }
 | DIV   { op = DIVOP;   }
+| SHIFTLEFT  { op = SHIFTLEFTOP;  }
+| SHIFTRIGHT { op = SHIFTRIGHTOP; }
 ;
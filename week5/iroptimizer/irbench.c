@@ -0,0 +1,232 @@
+/* The optimizer regression harness (see the 'harness' target in the Makefile).
+ *
+ * usage: irbench <iroptimizer> <irgen> <redundancy %> <copy depth> <dead %> <growth limit>
+ *                <flags> <quadruples> ...
+ *
+ * For every size it generates a program with irgen, optimizes it with the given
+ * flags (one argument, split at spaces; "" for none) into binary IR, and records
+ * the wall time and the peak RSS of the optimizer. Both programs are then run with
+ * -run on the same inputs, values for v0 .. v63 drawn from a generator seeded with
+ * the size, and must leave the same variables; the share of the executed quadruples
+ * that the optimizations saved is reported as well. Going from one size to the next, time
+ * and RSS may grow by at most growth limit times the growth of the size; a larger
+ * growth is reported as a complexity regression. Sizes that take under 50 ms or
+ * 16 MB give no ratio, as their cost is mostly startup. After a regression the
+ * larger sizes are skipped. The files are left in the current directory. Exits
+ * with 1 if any check failed.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/wait.h>
+#include <sys/resource.h>
+
+#define MIN_SECONDS 0.05
+#define MIN_RSS_MB 16.0
+#define MAX_FLAGS 16
+#define INPUT_VARIABLES 64      /* irgen names its variables v0 .. v63 */
+#define MAX_INPUT_VALUE 1000000
+
+typedef struct measurement {
+    long size;
+    double seconds;
+    double rss_mb;
+} measurement;
+
+static double now() {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+/* Runs argv with stdout sent to output and, unless it is NULL, stderr to errors,
+ and returns the wall time; the peak RSS in MB goes to *rss_mb. Exits if the
+ command fails. */
+static double runCommand(char **argv, char *output, char *errors, double *rss_mb) {
+    struct rusage usage;
+    int status;
+    double start = now();
+    pid_t pid = fork();
+
+    if (pid < 0) {
+        perror("fork");
+        exit(EXIT_FAILURE);
+    }
+    if (pid == 0) {
+        int fd = open(output, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (fd < 0 || dup2(fd, STDOUT_FILENO) < 0) {
+            perror(output);
+            _exit(127);
+        }
+        if (errors != NULL) {
+            fd = open(errors, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+            if (fd < 0 || dup2(fd, STDERR_FILENO) < 0) {
+                perror(errors);
+                _exit(127);
+            }
+        }
+        execv(argv[0], argv);
+        perror(argv[0]);
+        _exit(127);
+    }
+    if (wait4(pid, &status, 0, &usage) != pid || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+        fprintf(stderr, "irbench: %s failed (writing %s)\n", argv[0], output);
+        exit(EXIT_FAILURE);
+    }
+    *rss_mb = usage.ru_maxrss / 1024.0;
+    return now() - start;
+}
+
+static int sameFiles(char *name1, char *name2) {
+    FILE *f1 = fopen(name1, "rb"), *f2 = fopen(name2, "rb");
+    int c1, c2, same = (f1 != NULL && f2 != NULL);
+    while (same) {
+        c1 = getc(f1);
+        c2 = getc(f2);
+        same = (c1 == c2);
+        if (c1 == EOF) {
+            break;
+        }
+    }
+    if (f1 != NULL) {
+        fclose(f1);
+    }
+    if (f2 != NULL) {
+        fclose(f2);
+    }
+    return same;
+}
+
+// The quadruple count in the header of a binary IR file.
+static long binaryQuadrupleCount(char *name) {
+    unsigned char header[16];
+    FILE *f = fopen(name, "rb");
+    long count = -1;
+    if (f != NULL && fread(header, 1, 16, f) == 16) {
+        count = header[12] | (header[13] << 8) | (header[14] << 16) | ((long)header[15] << 24);
+    }
+    if (f != NULL) {
+        fclose(f);
+    }
+    return count;
+}
+
+// The number of quadruples executed, from the -profile output of a run.
+static long executedQuadruples(char *name) {
+    FILE *f = fopen(name, "r");
+    long executed = -1;
+    if (f != NULL) {
+        if (fscanf(f, "executed %ld", &executed) != 1) {
+            executed = -1;
+        }
+        fclose(f);
+    }
+    return executed;
+}
+
+/* Builds "-input=v0=...,v63=..." with values from -MAX_INPUT_VALUE to
+ MAX_INPUT_VALUE, about half of them negative so that irgen's jumps go both ways.
+ The same seed gives the same values on every platform. */
+static void makeInputOption(char *option, size_t size, unsigned long seed) {
+    unsigned long long state = seed;
+    size_t length = snprintf(option, size, "-input=");
+    int v;
+    for (v = 0; v < INPUT_VARIABLES && length < size; v++) {
+        state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+        long value = (long)((state >> 33) % (2 * MAX_INPUT_VALUE + 1)) - MAX_INPUT_VALUE;
+        length += snprintf(option + length, size - length, "%sv%d=%ld", (v == 0 ? "" : ","), v, value);
+    }
+}
+
+/* Checks the growth from one measurement to the next; returns 0 if it is too large. */
+static int checkGrowth(measurement *previous, measurement *current, double limit) {
+    double size_growth = (double)current->size / previous->size;
+    int ok = 1;
+    if (previous->seconds >= MIN_SECONDS && current->seconds / previous->seconds > limit * size_growth) {
+        printf("complexity regression: time grew %.1fx for %.1fx the quadruples\n",
+               current->seconds / previous->seconds, size_growth);
+        ok = 0;
+    }
+    if (previous->rss_mb >= MIN_RSS_MB && current->rss_mb / previous->rss_mb > limit * size_growth) {
+        printf("complexity regression: RSS grew %.1fx for %.1fx the quadruples\n",
+               current->rss_mb / previous->rss_mb, size_growth);
+        ok = 0;
+    }
+    return ok;
+}
+
+int main(int argc, char **argv) {
+    if (argc < 9) {
+        fprintf(stderr, "usage: %s <iroptimizer> <irgen> <redundancy %%> <copy depth> <dead %%> <growth limit> "
+                "<flags> <quadruples> ...\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+    char *optimizer = argv[1], *generator = argv[2];
+    double limit = atof(argv[6]);
+    char *optimize[MAX_FLAGS + 5];
+    int optimize_count = 0, size_count = argc - 8, failures = 0, i;
+    measurement *measurements = malloc(size_count * sizeof(measurement));
+    char program[64], optimized[64], expected[64], actual[64], profile[64], size[32];
+    char input[INPUT_VARIABLES * 24];
+    double rss_mb;
+
+    optimize[optimize_count++] = optimizer;
+    optimize[optimize_count++] = "-binary";
+    char *flag = strtok(argv[7], " ");
+    while (flag != NULL && optimize_count < MAX_FLAGS + 2) {
+        optimize[optimize_count++] = flag;
+        flag = strtok(NULL, " ");
+    }
+    optimize[optimize_count + 1] = NULL;
+
+    printf("%12s %10s %10s %10s %12s %10s  %s\n", "quadruples", "seconds", "ns/quad", "RSS MB", "kept", "work saved",
+           "result");
+    for (i = 0; i < size_count; i++) {
+        measurement *m = &measurements[i];
+        m->size = atol(argv[8 + i]);
+        snprintf(size, sizeof(size), "%ld", m->size);
+        snprintf(program, sizeof(program), "%ld.ir", m->size);
+        snprintf(optimized, sizeof(optimized), "%ld.qir", m->size);
+        snprintf(expected, sizeof(expected), "%ld.expected", m->size);
+        snprintf(actual, sizeof(actual), "%ld.actual", m->size);
+        snprintf(profile, sizeof(profile), "%ld.profile", m->size);
+
+        char *generate[] = {generator, size, argv[3], argv[4], argv[5], NULL};
+        runCommand(generate, program, NULL, &rss_mb);
+
+        optimize[optimize_count] = program;
+        m->seconds = runCommand(optimize, optimized, NULL, &m->rss_mb);
+
+        makeInputOption(input, sizeof(input), m->size);
+        char *run_program[] = {optimizer, "-passes=", "-run", "-profile", input, program, NULL};
+        runCommand(run_program, expected, profile, &rss_mb);
+        long executed = executedQuadruples(profile);
+        char *run_optimized[] = {optimizer, "-passes=", "-run", "-profile", input, optimized, NULL};
+        runCommand(run_optimized, actual, profile, &rss_mb);
+        long executed_optimized = executedQuadruples(profile);
+
+        int equivalent = sameFiles(expected, actual);
+        printf("%12ld %10.3f %10.1f %10.1f %12ld %9.1f%%  %s\n", m->size, m->seconds, 1e9 * m->seconds / m->size,
+               m->rss_mb, binaryQuadrupleCount(optimized),
+               (executed > 0 ? 100.0 * (executed - executed_optimized) / executed : 0.0),
+               (equivalent ? "equivalent" : "DIFFERENT"));
+        if (!equivalent) {
+            failures++;
+        }
+        if (i > 0 && !checkGrowth(&measurements[i - 1], m, limit)) {
+            failures++;
+            if (i + 1 < size_count) {
+                printf("the larger sizes are skipped\n");
+            }
+            break;
+        }
+        fflush(stdout);
+    }
+
+    free(measurements);
+    return (failures > 0 ? EXIT_FAILURE : EXIT_SUCCESS);
+}
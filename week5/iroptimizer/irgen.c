@@ -0,0 +1,215 @@
+/* Generates a synthetic IR program for the optimizer harness (see the 'harness'
+ * target in the Makefile) and writes it to stdout.
+ *
+ * usage: irgen <quadruples> <redundancy %> <copy chain depth> <dead code %> [seed]
+ *
+ * redundancy %   of the expressions repeat an earlier one whose operands still
+ *                hold the same values (commutative ones are sometimes swapped)
+ * copy depth     length of the copy chains x1 = y; x2 = x1; ... that one in eight
+ *                statements starts; 0 for none
+ * dead code %    of the statements assign a variable that the next one overwrites
+ *
+ * The program is split into functions, and those into blocks that end in forward
+ * jumps to a label a few blocks further on, so every run of it ends. A jump is
+ * taken if a variable is negative, so about half the blocks run. Divisors are
+ * constants from 2 to 9, so no run divides by zero.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#define VARIABLES 64
+#define FUNCTION_SIZE 10000
+#define MAX_BLOCK_SIZE 64
+#define RECENT 16
+
+typedef struct expression {
+    int operand1, operand2;     /* variable, or -1 - constant */
+    int version1, version2;     /* of the variables when the expression was computed */
+    char operation;
+} expression;
+
+static unsigned long random_state = 12345;
+static int version[VARIABLES];
+static expression recent[RECENT];
+static int recent_count = 0;
+static long emitted = 0;
+
+// Small LCG, so that the generated programs are the same on every platform.
+static unsigned int nextRandom(unsigned int bound) {
+    random_state = random_state * 6364136223846793005UL + 1442695040888963407UL;
+    return (unsigned int)((random_state >> 33) % bound);
+}
+
+static void printOperand(int op) {
+    if (op >= 0) {
+        printf("v%d", op);
+    }
+    else {
+        printf("%d", -1 - op);
+    }
+}
+
+// A variable, or in one case of four a constant from 0 to 9.
+static int randomOperand() {
+    return (nextRandom(4) == 0 ? -1 - (int)nextRandom(10) : (int)nextRandom(VARIABLES));
+}
+
+static int operandVersion(int op) {
+    return (op >= 0 ? version[op] : 0);
+}
+
+static void assign(int lhs) {
+    version[lhs]++;
+    emitted++;
+}
+
+static void printExpression(int lhs, expression e) {
+    printf("v%d = ", lhs);
+    printOperand(e.operand1);
+    if (e.operation == '<' || e.operation == '>') {
+        printf(" %c%c ", e.operation, e.operation);
+    }
+    else {
+        printf(" %c ", e.operation);
+    }
+    printOperand(e.operand2);
+    printf(";\n");
+}
+
+static expression newExpression() {
+    static const char operations[] = "++--**/<>";
+    expression e;
+    e.operation = operations[nextRandom(sizeof(operations) - 1)];
+    e.operand1 = randomOperand();
+    if (e.operation == '/') {
+        e.operand2 = -1 - (int)(2 + nextRandom(8));
+    }
+    else if (e.operation == '<' || e.operation == '>') {
+        e.operand2 = -1 - (int)nextRandom(8);
+    }
+    else {
+        e.operand2 = randomOperand();
+    }
+    return e;
+}
+
+/* One of the recent expressions whose operands were not assigned since; a new
+ one if there is none. */
+static expression repeatedExpression() {
+    int tries;
+    for (tries = 0; tries < 4 && recent_count > 0; tries++) {
+        expression e = recent[nextRandom(recent_count < RECENT ? recent_count : RECENT)];
+        if (e.version1 == operandVersion(e.operand1) && e.version2 == operandVersion(e.operand2)) {
+            if ((e.operation == '+' || e.operation == '*') && nextRandom(2) == 0) {
+                int swap = e.operand1;
+                e.operand1 = e.operand2;
+                e.operand2 = swap;
+            }
+            return e;
+        }
+    }
+    return newExpression();
+}
+
+// Assigns an expression to a variable that is not one of its operands.
+static void emitExpression(int lhs, int redundancy) {
+    expression e = (nextRandom(100) < (unsigned int)redundancy ? repeatedExpression() : newExpression());
+    while (lhs == e.operand1 || lhs == e.operand2) {
+        lhs = nextRandom(VARIABLES);
+    }
+    e.version1 = operandVersion(e.operand1);
+    e.version2 = operandVersion(e.operand2);
+    recent[recent_count++ % RECENT] = e;
+    printExpression(lhs, e);
+    assign(lhs);
+}
+
+static void emitCopyChain(int depth) {
+    int source = nextRandom(VARIABLES), i;
+    for (i = 0; i < depth; i++) {
+        int lhs = nextRandom(VARIABLES);
+        printf("v%d = v%d;\n", lhs, source);
+        assign(lhs);
+        source = lhs;
+    }
+}
+
+static void emitStatement(int redundancy, int depth, int dead) {
+    int lhs = nextRandom(VARIABLES);
+    if (depth > 0 && nextRandom(8) == 0) {
+        emitCopyChain(depth);
+    }
+    else if (nextRandom(100) < (unsigned int)dead) {
+        expression e = newExpression();
+        printExpression(lhs, e);
+        assign(lhs);
+        /* The overwriting expression must not read lhs either. */
+        do {
+            e = newExpression();
+        } while (e.operand1 == lhs || e.operand2 == lhs);
+        printExpression(lhs, e);
+        assign(lhs);
+    }
+    else {
+        emitExpression(lhs, redundancy);
+    }
+}
+
+int main(int argc, char **argv) {
+    if (argc != 5 && argc != 6) {
+        fprintf(stderr, "usage: %s <quadruples> <redundancy %%> <copy chain depth> <dead code %%> [seed]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+    long quadruple_count = atol(argv[1]);
+    int redundancy = atoi(argv[2]), depth = atoi(argv[3]), dead = atoi(argv[4]);
+    if (argc == 6) {
+        random_state = strtoul(argv[5], NULL, 10);
+    }
+
+    int label_count = 0, function_count = 0;
+    int pending_label = -1, blocks_to_label = 0;
+    long function_end = 0;
+    while (emitted < quadruple_count) {
+        if (emitted >= function_end) {
+            if (pending_label >= 0) {
+                printf("L%d:\n", pending_label);
+                pending_label = -1;
+            }
+            printf("function f%d:\n", function_count++);
+            function_end = emitted + FUNCTION_SIZE;
+            recent_count = 0;
+        }
+
+        long block_end = emitted + 1 + nextRandom(MAX_BLOCK_SIZE);
+        while (emitted < block_end && emitted < quadruple_count) {
+            emitStatement(redundancy, depth, dead);
+        }
+
+        /* Other paths join at the label, which ends the reuse of the expressions. */
+        if (pending_label >= 0 && --blocks_to_label == 0) {
+            printf("L%d:\n", pending_label);
+            pending_label = -1;
+            recent_count = 0;
+        }
+        if (pending_label < 0) {
+            pending_label = label_count++;
+            blocks_to_label = 1 + nextRandom(3);
+            if (nextRandom(8) == 0) {
+                printf("goto L%d;\n", pending_label);
+            }
+            else {
+                int condition = nextRandom(VARIABLES);
+                printf("v%d = v%d >> 31;\n", condition, nextRandom(VARIABLES));
+                printf("if v%d goto L%d;\n", condition, pending_label);
+                assign(condition);
+            }
+            emitted++;
+        }
+    }
+    if (pending_label >= 0) {
+        printf("L%d:\n", pending_label);
+    }
+
+    return EXIT_SUCCESS;
+}
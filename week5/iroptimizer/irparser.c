@@ -0,0 +1,292 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "misc.h"
+#include "quadruple.h"
+#include "irparser.h"
+
+extern void processQuadruple(quadruple q);
+
+typedef enum tokenKind {
+    END_TOKEN, IDENTIFIER_TOKEN, CONSTANT_TOKEN, EQUALS_TOKEN, SEMICOLON_TOKEN,
+    COLON_TOKEN, OPERATOR_TOKEN, GOTO_TOKEN, IF_TOKEN, FUNCTION_TOKEN
+} tokenKind;
+
+/* Character classes, so the inner loops are one table lookup per byte. */
+#define LETTER_CLASS 1
+#define DIGIT_CLASS  2
+#define SPACE_CLASS  4
+
+typedef struct irScanner {
+    const char *p, *end;
+    const char *line_start;     /* start of the current line, for error messages */
+    int linenr, column;         /* counted as ir.lex counts them */
+    tokenKind kind;             /* the current token */
+    const char *token;
+    int length;
+    operator operation;         /* of an OPERATOR_TOKEN */
+} irScanner;
+
+static unsigned char char_class[256];
+
+static void initializeCharClasses() {
+    int c;
+    for (c = 0; c < 256; c++) {
+        char_class[c] = 0;
+    }
+    for (c = 'a'; c <= 'z'; c++) {
+        char_class[c] = char_class[c - 'a' + 'A'] = LETTER_CLASS;
+    }
+    for (c = '0'; c <= '9'; c++) {
+        char_class[c] = DIGIT_CLASS;
+    }
+    char_class[' '] = char_class['\t'] = SPACE_CLASS;
+}
+
+// Prints the line of the current token like showLine() in ir.lex.
+static void showScannerLine(irScanner *sc, int showcolumn) {
+    const char *eol = memchr(sc->line_start, '\n', sc->end - sc->line_start);
+    int i;
+    fprintf(stderr, "%4d: %.*s\n", sc->linenr + 1, (int)((eol == NULL ? sc->end : eol) - sc->line_start),
+            sc->line_start);
+    if (showcolumn) {
+        fprintf(stderr, "      ");
+        for (i = 0; i < sc->column; i++) {
+            fprintf(stderr, " ");
+        }
+        fprintf(stderr, "^\n");
+    }
+}
+
+static void syntaxError(irScanner *sc) {
+    showScannerLine(sc, 1);
+    printf("syntax error\n");
+    exit(EXIT_FAILURE);
+}
+
+static int isKeyword(irScanner *sc, const char *keyword, int length) {
+    return sc->length == length && memcmp(sc->token, keyword, length) == 0;
+}
+
+static void nextToken(irScanner *sc) {
+    const char *p = sc->p;
+
+    for (;;) {
+        if (p == sc->end) {
+            sc->p = p;
+            sc->kind = END_TOKEN;
+            return;
+        }
+        if (char_class[(unsigned char)*p] == SPACE_CLASS) {
+            sc->column++;
+        }
+        else if (*p == '\n') {
+            sc->linenr++;
+            sc->column = 0;
+            sc->line_start = p + 1;
+        }
+        else {
+            break;
+        }
+        p++;
+    }
+
+    sc->token = p;
+    unsigned char c = *p++;
+    if (char_class[c] == LETTER_CLASS) {
+        while (p < sc->end && (char_class[(unsigned char)*p] & (LETTER_CLASS | DIGIT_CLASS))) {
+            p++;
+        }
+        sc->length = p - sc->token;
+        sc->kind = (isKeyword(sc, "goto", 4) ? GOTO_TOKEN : isKeyword(sc, "if", 2) ? IF_TOKEN :
+                    isKeyword(sc, "function", 8) ? FUNCTION_TOKEN : IDENTIFIER_TOKEN);
+    }
+    else if (char_class[c] == DIGIT_CLASS || (c == '_' && p < sc->end && char_class[(unsigned char)*p] == DIGIT_CLASS)) {
+        while (p < sc->end && char_class[(unsigned char)*p] == DIGIT_CLASS) {
+            p++;
+        }
+        sc->kind = (c == '_' ? IDENTIFIER_TOKEN : CONSTANT_TOKEN);
+    }
+    else {
+        sc->kind = OPERATOR_TOKEN;
+        switch (c) {
+            case '=': sc->kind = EQUALS_TOKEN; break;
+            case ';': sc->kind = SEMICOLON_TOKEN; break;
+            case ':': sc->kind = COLON_TOKEN; break;
+            case '+': sc->operation = PLUSOP; break;
+            case '-': sc->operation = MINUSOP; break;
+            case '*': sc->operation = TIMESOP; break;
+            case '/': sc->operation = DIVOP; break;
+            case '<':
+            case '>':
+                if (p < sc->end && *p == (char)c) {
+                    sc->operation = (c == '<' ? SHIFTLEFTOP : SHIFTRIGHTOP);
+                    p++;
+                    break;
+                }
+                /* fall through */
+            default:
+                sc->p = p - 1;
+                showScannerLine(sc, 1);
+                abortMessage("Unexpected characater [%c]\n", c);
+        }
+    }
+    sc->length = p - sc->token;
+    sc->column += sc->length;
+    sc->p = p;
+}
+
+/* The value atoll() gives for the digits of the current token; makeConstantOperand()
+ then wraps it to the word size. */
+static constantValue tokenValue(irScanner *sc) {
+    unsigned long long value = 0;
+    int i;
+    for (i = 0; i < sc->length; i++) {
+        unsigned int digit = sc->token[i] - '0';
+        if (value > (LLONG_MAX - digit) / 10) {
+            return LLONG_MAX;
+        }
+        value = 10 * value + digit;
+    }
+    return (constantValue)value;
+}
+
+/* The value of the constant -digits, as the bison parser reads it: the digits are
+ read unsigned, saturating like strtoull(), and negated. */
+static constantValue negativeTokenValue(irScanner *sc) {
+    unsigned long long value = 0;
+    int i;
+    for (i = 0; i < sc->length; i++) {
+        unsigned int digit = sc->token[i] - '0';
+        if (value > (ULLONG_MAX - digit) / 10) {
+            value = ULLONG_MAX;
+            break;
+        }
+        value = 10 * value + digit;
+    }
+    return (constantValue)(0 - value);
+}
+
+static symbolId expectName(irScanner *sc) {
+    nextToken(sc);
+    if (sc->kind != IDENTIFIER_TOKEN) {
+        syntaxError(sc);
+    }
+    return internSymbolRange(sc->token, sc->length);
+}
+
+static operand expectOperand(irScanner *sc) {
+    nextToken(sc);
+    if (sc->kind == IDENTIFIER_TOKEN) {
+        return makeVariableOperand(internSymbolRange(sc->token, sc->length));
+    }
+    if (sc->kind == CONSTANT_TOKEN) {
+        return makeConstantOperand(tokenValue(sc));
+    }
+    if (sc->kind == OPERATOR_TOKEN && sc->operation == MINUSOP) {
+        nextToken(sc);
+        if (sc->kind == CONSTANT_TOKEN) {
+            return makeConstantOperand(negativeTokenValue(sc));
+        }
+    }
+    syntaxError(sc);
+    return makeNoOperand();
+}
+
+static void expectToken(irScanner *sc, tokenKind kind) {
+    nextToken(sc);
+    if (sc->kind != kind) {
+        syntaxError(sc);
+    }
+}
+
+static void parseLines(irScanner *sc) {
+    for (nextToken(sc); sc->kind != END_TOKEN; nextToken(sc)) {
+        symbolId name;
+        operand condition;
+
+        switch (sc->kind) {
+            case IDENTIFIER_TOKEN:
+                name = internSymbolRange(sc->token, sc->length);
+                nextToken(sc);
+                if (sc->kind == COLON_TOKEN) {
+                    processQuadruple(makeQuadruple(name, LABELOP, makeNoOperand(), makeNoOperand()));
+                    break;
+                }
+                if (sc->kind != EQUALS_TOKEN) {
+                    syntaxError(sc);
+                }
+                operand op1 = expectOperand(sc);
+                nextToken(sc);
+                if (sc->kind == OPERATOR_TOKEN) {
+                    operator operation = sc->operation;
+                    operand op2 = expectOperand(sc);
+                    processQuadruple(makeQuadruple(name, operation, op1, op2));
+                    expectToken(sc, SEMICOLON_TOKEN);
+                }
+                else {
+                    processQuadruple(makeQuadruple(name, ASSIGNMENT, op1, makeNoOperand()));
+                    if (sc->kind != SEMICOLON_TOKEN) {
+                        syntaxError(sc);
+                    }
+                }
+                break;
+            case GOTO_TOKEN:
+                name = expectName(sc);
+                expectToken(sc, SEMICOLON_TOKEN);
+                processQuadruple(makeQuadruple(name, GOTOOP, makeNoOperand(), makeNoOperand()));
+                break;
+            case IF_TOKEN:
+                condition = expectOperand(sc);
+                expectToken(sc, GOTO_TOKEN);
+                name = expectName(sc);
+                expectToken(sc, SEMICOLON_TOKEN);
+                processQuadruple(makeQuadruple(name, IFGOTOOP, condition, makeNoOperand()));
+                break;
+            case FUNCTION_TOKEN:
+                name = expectName(sc);
+                expectToken(sc, COLON_TOKEN);
+                processQuadruple(makeQuadruple(name, FUNCTIONOP, makeNoOperand(), makeNoOperand()));
+                break;
+            default:
+                syntaxError(sc);
+        }
+    }
+}
+
+void fastParseProgram(char *filename) {
+    int fd = open(filename, O_RDONLY);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) != 0) {
+        abortMessage("Error: Failed to open file [%s]", filename);
+    }
+    if (!S_ISREG(st.st_mode)) {
+        /* A pipe has no size to map; the bison parser reads one as a stream. */
+        abortMessage("Error: -fastparse needs a regular file, [%s] is not one.", filename);
+    }
+    size_t size = st.st_size;
+    const char *text = "";
+    if (size > 0) {
+        text = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (text == MAP_FAILED) {
+            abortMessage("Error: Failed to map file [%s]", filename);
+        }
+    }
+    close(fd);
+
+    irScanner sc;
+    initializeCharClasses();
+    sc.p = sc.line_start = text;
+    sc.end = text + size;
+    sc.linenr = sc.column = 0;
+    parseLines(&sc);
+
+    if (size > 0) {
+        munmap((void *)text, size);
+    }
+}
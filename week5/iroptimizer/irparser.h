@@ -0,0 +1,12 @@
+#ifndef IRPARSER_H
+#define IRPARSER_H
+
+/* A hand-written parser for the text IR, as an alternative to the flex and bison
+ one (-fastparse). The file is mapped instead of read, names are interned straight
+ from the mapping, and every quadruple goes to processQuadruple() as soon as it is
+ complete, so nothing is allocated per line. It accepts exactly the language of
+ ir.lex and ir.y, and reports errors with the same messages, line and column. */
+
+void fastParseProgram(char *filename);
+
+#endif
@@ -1,287 +1,429 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
+#include <pthread.h>
 #include "quadruple.h"
 #include "deadcode.h"
+#include "subexpression.h"
+#include "copytable.h"
+#include "simplify.h"
+#include "ssa.h"
+#include "regalloc.h"
+#include "cfg.h"
+#include "dataflow.h"
+#include "stream.h"
+#include "binaryir.h"
+#include "irparser.h"
+#include "passes.h"
+#include "interpreter.h"
+#include "context.h"
 #include "misc.h"
 
 extern int yyparse();
 extern void initLexer(char *fnm);
 extern void finalizeLexer();
 
-typedef struct stringPair {
-    char *key, *str;
-} stringPair;
+static int stream_window = 0;   /* quadruples per window in streaming mode, 0 otherwise */
 
-static stringPair *table = NULL;
-static int tableSize=0;     /* number of pairs in the pair table */
-static int allocatedSize=0; /* allocated number of table entries */
+/* Every "function" marker starts a partition with a context of its own. The forward
+ passes run while parsing, on the context of the partition being read; the global
+ passes run afterwards, one partition per thread at a time. */
+static optimizerContext **partitions = NULL;
+static int partition_count = 0;
+static int partition_allocated_size = 0;
 
-static quadruple *subexp_table = NULL;
-static int subexp_table_size=0;
-static int subexp_table_alocated_size = 0;
-static int temp_variable_count = 1;
+static int ssa = 0, dataflow = 0;
+static int register_count = 0;   /* temporaries are allocated to registers if > 0 */
+static int next_partition = 0;  /* the next partition a worker takes */
+static pthread_mutex_t next_partition_lock = PTHREAD_MUTEX_INITIALIZER;
 
-static void resizeStringTable() {
-    allocatedSize = (allocatedSize == 0 ? 1 : 2*allocatedSize);
-    table = safeRealloc(table, allocatedSize*sizeof(stringPair));
+/********************************************************************/
+operand replace(operand op) {
+    return replaceWithCopy(getOptimizerContext()->copies, op);
 }
 
-static void resizeSubexpressionTable(){
-    subexp_table_alocated_size = (subexp_table_alocated_size == 0 ? 1 : 2 * subexp_table_alocated_size);
-    subexp_table = safeRealloc(subexp_table, subexp_table_alocated_size * sizeof(quadruple));
+/* Appends the quadruple to the queue. In streaming mode a full queue is spilled to
+ disk; no later quadruple may refer back into it, so the tables are cleared as at a
+ label and the temporaries are numbered from _1 again. */
+static void emitQuadruple(quadruple quad) {
+    insertQuadrupleInQueue(quad);
+    if (stream_window > 0 && getQuadrupleQueueSize() >= stream_window) {
+        spillQuadrupleQueue();
+        clearCopyTable(getOptimizerContext()->copies);
+        clearChainTable(getOptimizerContext()->chains);
+        clearAvailableExpressions();
+        restartTemporaries();
+    }
 }
 
-static int lookupInStringTable(char *key) {
-    int i;
-    for (i=0; i < tableSize; i++) {
-        if (areEqualStrings(table[i].key, key)) {
-            return i;
-        }
+/* A function marker ends the partition before it; its forward tables go then. */
+static void startPartition() {
+    if (partition_count > 0) {
+        releaseForwardPassTables(partitions[partition_count - 1]);
+    }
+    if (partition_count == partition_allocated_size) {
+        partition_allocated_size = (partition_allocated_size == 0 ? 16 : 2 * partition_allocated_size);
+        partitions = safeRealloc(partitions, partition_allocated_size * sizeof(optimizerContext *));
     }
-    return -1;  /* not found */
+    partitions[partition_count] = createOptimizerContext();
+    setOptimizerContext(partitions[partition_count]);
+    partition_count++;
+}
+
+/* Copy propagation: the operands that hold a copy are replaced by its value. */
+static quadruple propagateCopies(quadruple quad) {
+    double start = startPassClock();
+    operand operand1 = replace(quad.operand1), operand2 = replace(quad.operand2);
+
+    countPassRewrites(COPYPROP_PASS, !isEqualOperand(operand1, quad.operand1) +
+                                     !isEqualOperand(operand2, quad.operand2));
+    quad.operand1 = operand1;
+    quad.operand2 = operand2;
+    stopPassClock(COPYPROP_PASS, start);
+    return quad;
 }
 
-static int areEqualSubexpressions(quadruple quad1, quadruple quad2){
-    if (quad1.operation == quad2.operation){
-        if (areEqualStrings(quad1.operand1, quad2.operand1)){
-            if (areEqualStrings(quad1.operand2, quad2.operand2)){
-                return 1;
+void processQuadruple(quadruple quad) {
+    copyTable *copies = getOptimizerContext()->copies;
+    chainTable *chains = getOptimizerContext()->chains;
+    double start;
+
+    /* Control flow. Other paths join at a label, so nothing known before it still
+     holds there. A jump ends a block, but the code after it can only be reached by
+     falling through, so the tables stay valid. A function can only be entered at
+     its start; in streaming mode it shares the window with the code before it. */
+    if (!definesVariable(quad)) {
+        markLabelSymbol(quad.lhs);
+    }
+    switch (quad.operation) {
+        case FUNCTIONOP:
+            if (stream_window > 0) {
+                clearCopyTable(copies);
+                clearChainTable(chains);
+                clearAvailableExpressions();
             }
-        }
-        else if(quad1.operation == PLUSOP || quad1.operation == TIMESOP){
-            // Considers commutativity
-            if (areEqualStrings(quad1.operand1, quad2.operand2)){
-                if (areEqualStrings(quad1.operand2, quad2.operand1)){
-                    return 1;
+            else {
+                startPartition();
+            }
+            emitQuadruple(quad);
+            return;
+        case LABELOP:
+            clearCopyTable(copies);
+            clearChainTable(chains);
+            clearAvailableExpressions();
+            emitQuadruple(quad);
+            return;
+        case GOTOOP:
+            emitQuadruple(quad);
+            return;
+        case IFGOTOOP:
+            if (isPassEnabled(COPYPROP_PASS)) {
+                quad = propagateCopies(quad);
+            }
+            /* A constant condition decides the jump: it is never taken or always. */
+            if (isPassEnabled(SIMPLIFY_PASS) && quad.operand1.kind == CONSTANT_OPERAND) {
+                countPassRewrites(SIMPLIFY_PASS, 1);
+                if (quad.operand1.value == 0) {
+                    return;
                 }
+                quad = makeQuadruple(quad.lhs, GOTOOP, makeNoOperand(), makeNoOperand());
             }
-        }
+            emitQuadruple(quad);
+            return;
+        default:
+            break;
     }
-    return 0;
-}
 
-static int lookupInSubexpressionTable(quadruple q){
-    int i;
-    for (i = 0; i < subexp_table_size; i++){
-        if (areEqualSubexpressions(subexp_table[i], q)){
-            return i;
+    /* Copy propagation, then constant folding or algebraic simplification. Either
+     may turn the quadruple into a copy. */
+    if (isPassEnabled(COPYPROP_PASS)) {
+        quad = propagateCopies(quad);
+    }
+    if (isPassEnabled(SIMPLIFY_PASS)) {
+        quadruple original = quad;
+        start = startPassClock();
+        if (quad.operation != ASSIGNMENT) {
+            if (isFoldableQuadruple(quad)) {
+                quad.operand1 = makeConstantOperand(calculateQuadruple(quad));
+                quad.operand2 = makeNoOperand();
+                quad.operation = ASSIGNMENT;
+            }
+            else {
+                quad = simplifyQuadruple(chains, quad);
+            }
         }
+        recordDefinition(chains, quad);
+        countPassRewrites(SIMPLIFY_PASS, !isEqualQuadruple(quad, original));
+        stopPassClock(SIMPLIFY_PASS, start);
+    }
+    if (isPassEnabled(COPYPROP_PASS)) {
+        start = startPassClock();
+        killCopies(copies, quad.lhs);
+        if (quad.operation == ASSIGNMENT) {
+            insertCopy(copies, quad.lhs, quad.operand1);
+        }
+        notePassTableSize(COPYPROP_PASS, getCopyTableSize(copies));
+        stopPassClock(COPYPROP_PASS, start);
     }
-    return -1; // not found
-}
 
-static void insertStringPair(char *key, char *str) {
-    int idx = lookupInStringTable(key);
-    if (idx != -1) {
-        free(table[idx].str);
-        table[idx].str = stringDuplicate(str);
+    /* Common subexpression elimination. */
+    if (!isPassEnabled(CSE_PASS)) {
+        emitQuadruple(quad);
         return;
     }
-    if (tableSize == allocatedSize) {
-        resizeStringTable();
+    start = startPassClock();
+
+    /* An expression whose value a variable already holds becomes a copy of it. A
+     new value is computed into a temporary, so it outlives the next assignment
+     of the LHS; not if the LHS is an operand, as the temporary would only be copied
+     back. A copy (i.e. a = b) just takes the value of b. */
+    if (quad.operand2.kind != NO_OPERAND) {
+        symbolId temp;
+        if (lookupAvailableExpression(quad, &temp)) {
+            countPassRewrites(CSE_PASS, 1);
+        }
+        else if (!isVariableOperand(quad.operand1, quad.lhs) && !isVariableOperand(quad.operand2, quad.lhs)) {
+            temp = insertAvailableExpression(quad);
+            insertQuadrupleInQueue(makeQuadruple(temp, quad.operation, quad.operand1, quad.operand2));
+            if (isPassEnabled(SIMPLIFY_PASS)) {
+                recordDefinition(chains, makeQuadruple(temp, quad.operation, quad.operand1, quad.operand2));
+            }
+        }
+        else {
+            temp = quad.lhs;
+        }
+        if (temp != quad.lhs) {
+            quad.operation = ASSIGNMENT;
+            quad.operand1 = makeVariableOperand(temp);
+            quad.operand2 = makeNoOperand();
+        }
     }
-    table[tableSize].key = stringDuplicate(key);
-    table[tableSize].str = stringDuplicate(str);
-    tableSize++;
+    /* The lhs now holds the value of the quadruple. */
+    assignValueNumber(quad);
+    notePassTableSize(CSE_PASS, getValueNodeCount());
+    stopPassClock(CSE_PASS, start);
+
+    emitQuadruple(quad);
 }
 
-static void insertSubexpression(quadruple quad){
-    int index = lookupInSubexpressionTable(quad);
 
-    if (index == -1){
-        if (subexp_table_size == subexp_table_alocated_size){
-            resizeSubexpressionTable();
+// Runs the global passes on the partitions that no other worker has taken yet.
+static void *optimizePartitions(void *unused) {
+    while (1) {
+        pthread_mutex_lock(&next_partition_lock);
+        int p = next_partition++;
+        pthread_mutex_unlock(&next_partition_lock);
+        if (p >= partition_count) {
+            return NULL;
         }
-        char *temp_name = malloc(sizeof(char)*12);
-        sprintf(temp_name, "_%d", temp_variable_count);
-        quadruple q;
-        q = makeQuadruple(temp_name, quad.operation, quad.operand1, quad.operand2);
-
-        subexp_table[subexp_table_size] = q;
-        subexp_table_size++;
-        free(temp_name);
-        temp_variable_count++;
-    }
-}
 
-static void removeStringPairs(char *key) {
-    /* remove any pair (x,y) where x==key or y==key from table */
-    int i, idx;
-    for (i=idx=0; i < tableSize; i++) {
-        if (areEqualStrings(table[i].key, key) ||
-            areEqualStrings(table[i].str, key)) {
-            free(table[i].key);
-            free(table[i].str);
-        } else {
-            table[idx++] = table[i];
+        setOptimizerContext(partitions[p]);
+        if (dataflow) {
+            /* The analyses of the code as parsed, before the global passes. */
+            controlFlowGraph *cfg = buildControlFlowGraph();
+            intSet live_at_exit = getLiveAtExit();
+            fprintfDataflow(stderr, cfg, live_at_exit);
+            freeIntSet(live_at_exit);
+            destroyControlFlowGraph(cfg);
         }
+        runGlobalPasses(register_count);
     }
-    tableSize = idx;
 }
 
-/* Remove an expression from the table if any operand is changed. */
-static void removeSubexpressionPairs(char *operand){
-    int i, index;
+static void runPartitionWorkers(int thread_count) {
+    pthread_t *threads = safeMalloc(thread_count * sizeof(pthread_t));
+    int i;
 
-    for(i = index = 0; i < subexp_table_size; i++){
-        if (areEqualStrings(subexp_table[i].operand1, operand) ||
-            areEqualStrings(subexp_table[i].operand2, operand)){
-            freeQuadruple(subexp_table[i]);
-        }
-        else{
-            subexp_table[index++] = subexp_table[i];
+    if (thread_count > partition_count) {
+        thread_count = partition_count;
+    }
+    for (i = 1; i < thread_count; i++) {
+        if (pthread_create(&threads[i], NULL, optimizePartitions, NULL) != 0) {
+            abortMessage("Error: failed to start a worker thread.");
         }
     }
-    subexp_table_size = index;
+    optimizePartitions(NULL);
+    for (i = 1; i < thread_count; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    free(threads);
 }
 
-static void deallocateTable() {
-    int i;
-    for (i=0; i < tableSize; i++) {
-        free(table[i].key);
-        free(table[i].str);
-    }
-    free(table);
-    table = NULL;
-    tableSize = 0;
-    allocatedSize = 0;
+/* -live=a,b,c gives the variables that are live at exit (none for "-live="). By
+ default they are all the variables of the program, and none of the temporaries. */
+static void parseLiveAtExitOption(char *list) {
+    clearLiveAtExit();
+    char *names = stringDuplicate(list);
+    char *name = strtok(names, ",");
+    while (name != NULL) {
+        addLiveAtExitVariable(internSymbol(name));
+        name = strtok(NULL, ",");
+    }
+    free(names);
 }
 
-static void deallocateSubexpressionTable(){
-    int i;
-    for (i = 0; i < subexp_table_size; i++){
-        freeQuadruple(subexp_table[i]);
+/* The default pipeline: all the forward passes, then the global passes for the
+ options given. Streaming mode can only run its own dead code elimination. */
+static void selectDefaultPasses() {
+    char list[128];
+    strcpy(list, "copyprop,simplify,cse,");
+    strcat(list, (stream_window > 0 ? "dce" : ssa ? "ssa" : "consolidate,dce"));
+    if (register_count > 0) {
+        strcat(list, ",regalloc");
     }
-    free(subexp_table);
-    subexp_table = NULL;
-    subexp_table_size = 0;
-    subexp_table_alocated_size = 0;
+    selectPasses(list);
 }
 
-/********************************************************************/
-char* replace(char *operand) {
-    int stringTableIndex = lookupInStringTable(operand);
-    if (stringTableIndex == -1) {
-        return operand;
-    }
-    else {
-        free(operand);
-        char *returnstr = malloc(sizeof(char) * (strlen(table[stringTableIndex].str) + 1));
-        strcpy(returnstr, table[stringTableIndex].str);
-        return returnstr;
+/* -input=a=1,b=-2 gives the values of variables when the program is run. */
+static void parseInputOption(char *list) {
+    char *pairs = stringDuplicate(list);
+    char *pair = strtok(pairs, ",");
+    while (pair != NULL) {
+        char *value = strchr(pair, '=');
+        if (value == NULL || value == pair) {
+            abortMessage("Error: -input expects var=value pairs, not [%s].", pair);
+        }
+        *value++ = '\0';
+        setInputValue(internSymbol(pair), atoll(value));
+        pair = strtok(NULL, ",");
     }
+    free(pairs);
 }
 
-int isConstant(char *operand) {
-    if (operand[0] > 47 && operand[0] < 58) {
-        return 1;
+int main(int argc, char **argv) {
+    char *usage = "Usage: %s [-ssa] [-dataflow] [-stream[=window]] [-threads=n] [-registers=n] [-wordsize=n] [-binary] [-fastparse] [-passes=pass,...] [-stats] [-run] [-input=var=value,...] [-profile] [-live=var,...] <program.ir>";
+    char *program = NULL, *pass_list = NULL;
+    int binary_output = 0, fast_parse = 0, run = 0;
+    int thread_count = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    int i;
+
+    initializeSymbolTable();
+    for (i = 1; i < argc; i++) {
+        if (strncmp(argv[i], "-live=", 6) == 0) {
+            parseLiveAtExitOption(argv[i] + 6);
+        }
+        else if (areEqualStrings(argv[i], "-ssa")) {
+            ssa = 1;
+        }
+        else if (areEqualStrings(argv[i], "-dataflow")) {
+            dataflow = 1;
+        }
+        else if (areEqualStrings(argv[i], "-binary")) {
+            binary_output = 1;
+        }
+        else if (areEqualStrings(argv[i], "-fastparse")) {
+            fast_parse = 1;
+        }
+        else if (strncmp(argv[i], "-passes=", 8) == 0) {
+            pass_list = argv[i] + 8;
+        }
+        else if (areEqualStrings(argv[i], "-run")) {
+            run = 1;
+        }
+        else if (strncmp(argv[i], "-input=", 7) == 0) {
+            parseInputOption(argv[i] + 7);
+        }
+        else if (areEqualStrings(argv[i], "-profile")) {
+            enableInterpreterProfile();
+        }
+        else if (areEqualStrings(argv[i], "-stats")) {
+            enablePassStatistics();
+        }
+        else if (areEqualStrings(argv[i], "-stream")) {
+            stream_window = DEFAULT_STREAM_WINDOW;
+        }
+        else if (strncmp(argv[i], "-stream=", 8) == 0 && atoi(argv[i] + 8) > 0) {
+            stream_window = atoi(argv[i] + 8);
+        }
+        else if (strncmp(argv[i], "-registers=", 11) == 0 && atoi(argv[i] + 11) > 0) {
+            register_count = atoi(argv[i] + 11);
+        }
+        else if (strncmp(argv[i], "-threads=", 9) == 0 && atoi(argv[i] + 9) > 0) {
+            thread_count = atoi(argv[i] + 9);
+        }
+        else if (strncmp(argv[i], "-wordsize=", 10) == 0) {
+            setWordSize(atoi(argv[i] + 10));
+        }
+        else if (argv[i][0] == '-' || program != NULL) {
+            abortMessage(usage, argv[0]);
+        }
+        else {
+            program = argv[i];
+        }
+    }
+    if (program == NULL || (stream_window > 0 && (ssa || dataflow || register_count > 0 || binary_output || run))) {
+        /* -ssa, -dataflow, -registers, -binary and -run need the whole program in memory. */
+        abortMessage(usage, argv[0]);
+    }
+    if (pass_list == NULL) {
+        selectDefaultPasses();
+    }
+    else if (ssa) {
+        /* -ssa only changes the default pipeline; list ssa instead. */
+        abortMessage(usage, argv[0]);
     }
     else {
-        return 0;
+        selectPasses(pass_list);
+    }
+    if (isPassEnabled(REGALLOC_PASS) && register_count == 0) {
+        abortMessage("Error: the regalloc pass needs -registers=n.");
+    }
+    if (stream_window > 0 && (getGlobalPassCount() != 1 || getGlobalPass(0) != DCE_PASS)) {
+        abortMessage("Error: dce is the only global pass in streaming mode, and it is required.");
     }
-}
-
-int calculateQuadruple(quadruple quad) {
-    int operand1 = atoi(quad.operand1);
-    int operand2 = atoi(quad.operand2);
 
-    int result;
-    switch(quad.operation) {
-        case PLUSOP:
-            result = operand1 + operand2;
-            break;
-        case MINUSOP:
-            result = operand1 - operand2;
-            break;
-        case TIMESOP:
-            result = operand1 * operand2;
-            break;
-        case DIVOP:
-            if (operand2 == 0) {
-                fprintf(stderr, "Error: division by zero!\n");
-                exit(EXIT_FAILURE);
-            }
-            result = operand1 / operand2;
-            break;
-        default:
-            fprintf(stderr, "Unknown error.\n");
-            exit(EXIT_FAILURE);
-            break;
+    if (dataflow || thread_count < 1) {
+        /* The dumps of several partitions must not interleave. */
+        thread_count = 1;
     }
-    return result;
-}
 
-void processQuadruple(quadruple quad) {
-    /* Copy propagation. */
-    if (quad.operation == ASSIGNMENT) {
-        quad.operand1 = replace(quad.operand1);
-        removeStringPairs(quad.lhs);
-        insertStringPair(quad.lhs, quad.operand1);
+    /* The input is text or binary IR; the binary form is recognized by its magic. */
+    startPartition();
+    if (isBinaryProgram(program)) {
+        readBinaryProgram(program);
+    }
+    else if (fast_parse) {
+        fastParseProgram(program);
     }
     else {
-        quad.operand1 = replace(quad.operand1);
-        quad.operand2 = replace(quad.operand2);
-        removeStringPairs(quad.lhs);
-
-        if (isConstant(quad.operand1) && isConstant(quad.operand2)) {
-            int result = calculateQuadruple(quad);
-            char *resultstr = malloc(sizeof(char) * 11);
-            sprintf(resultstr, "%d", result);
-            quad.operation = ASSIGNMENT;
-            strcpy(quad.operand1, resultstr);
-            free(resultstr);
-
-            insertStringPair(quad.lhs, quad.operand1);
+        initLexer(program);
+        yyparse();
+        finalizeLexer();
+    }
+    partitions[partition_count - 1]->ends_program = 1;
+    if (stream_window > 0) {
+        double start = startPassClock();
+        countPassRemovals(DCE_PASS, runStreamingDeadCodeElimination(stdout));
+        stopPassClock(DCE_PASS, start);
+        notePassTableSize(DCE_PASS, stream_window);
+        destroyStream();
+    }
+    else {
+        releaseForwardPassTables(partitions[partition_count - 1]);
+        runPartitionWorkers(thread_count);
+        if (run) {
+            interpretProgram(stdout, partitions, partition_count);
+        }
+        else if (binary_output) {
+            fwriteBinaryProgram(stdout, partitions, partition_count);
+        }
+        else {
+            for (i = 0; i < partition_count; i++) {
+                setOptimizerContext(partitions[i]);
+                fprintfQuadrupleQueue(stdout);
+            }
         }
     }
-
-    /* Common subexpression elimination. */
-
-    /* If one of the operands is equal to the LHS, there's no need to look for
-     it on the table. Also, if the expression is a unary operation (i.e. a = b),
-     just copy it.*/
-    if((quad.operand2 != NULL)
-       && !(areEqualStrings(quad.lhs, quad.operand1) ||
-            areEqualStrings(quad.lhs, quad.operand2))){
-
-           int index;
-           index = lookupInSubexpressionTable(quad);
-
-           if (index == -1){
-               insertSubexpression(quad);
-               insertQuadrupleInQueue(subexp_table[subexp_table_size-1]);
-               index = subexp_table_size-1;
-           }
-           quad.operation = ASSIGNMENT;
-           free(quad.operand1);
-           quad.operand1 = malloc(sizeof(char) * strlen(subexp_table[index].lhs)+1);
-           strcpy(quad.operand1, subexp_table[index].lhs);
-       }
-    removeSubexpressionPairs(quad.lhs);
-
-    insertQuadrupleInQueue(quad);
-    freeQuadruple(quad);
-}
-
-
-int main(int argc, char **argv) {
-    if (argc != 2) {
-        abortMessage("Usage: %s <program.ir>", argv[0]);
+    if (arePassStatisticsEnabled()) {
+        fprintfPassStatistics(stderr, partitions, partition_count);
     }
+    for (i = 0; i < partition_count; i++) {
+        destroyOptimizerContext(partitions[i]);
+    }
+    free(partitions);
 
-    initializeQuadrupleQueue();
-    initLexer(argv[1]);
-
-    yyparse();
-    runDeadCodeElimination();
-
-    fprintfQuadrupleQueue(stdout);
-    destroyQuadrupleQueue();
-
-    finalizeLexer();
-    deallocateTable();
-    deallocateSubexpressionTable();
+    destroySymbolTable();
 
     return EXIT_SUCCESS;
 }
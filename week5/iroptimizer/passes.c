@@ -0,0 +1,179 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "misc.h"
+#include "context.h"
+#include "deadcode.h"
+#include "ssa.h"
+#include "regalloc.h"
+#include "passes.h"
+
+static char *pass_names[PASS_COUNT] = {
+    "copyprop", "simplify", "cse", "consolidate", "dce", "ssa", "regalloc"
+};
+
+static int enabled[PASS_COUNT];
+static passId *global_passes = NULL;   /* in the order they run */
+static int global_pass_count = 0;
+static int global_pass_allocated_size = 0;
+static int statistics_enabled = 0;
+
+static int isForwardPass(passId pass) {
+    return pass <= CSE_PASS;
+}
+
+static passId lookupPass(char *name) {
+    int pass;
+    for (pass = 0; pass < PASS_COUNT; pass++) {
+        if (areEqualStrings(name, pass_names[pass])) {
+            return (passId)pass;
+        }
+    }
+    abortMessage("Error: unknown pass [%s].", name);
+    return COPYPROP_PASS;
+}
+
+/* The passes of a comma-separated list, e.g. "copyprop,cse,dce"; the empty list
+ selects none. A forward pass enables that pass; the global passes run in order. */
+void selectPasses(char *list) {
+    char *names = stringDuplicate(list);
+    char *name = strtok(names, ",");
+    int pass;
+
+    for (pass = 0; pass < PASS_COUNT; pass++) {
+        enabled[pass] = 0;
+    }
+    global_pass_count = 0;
+    while (name != NULL) {
+        pass = lookupPass(name);
+        enabled[pass] = 1;
+        if (!isForwardPass(pass)) {
+            if (global_pass_count == global_pass_allocated_size) {
+                global_pass_allocated_size = (global_pass_allocated_size == 0 ? 8 : 2 * global_pass_allocated_size);
+                global_passes = safeRealloc(global_passes, global_pass_allocated_size * sizeof(passId));
+            }
+            global_passes[global_pass_count++] = pass;
+        }
+        name = strtok(NULL, ",");
+    }
+    free(names);
+}
+
+int isPassEnabled(passId pass) {
+    return enabled[pass];
+}
+
+char *getPassName(passId pass) {
+    return pass_names[pass];
+}
+
+int getGlobalPassCount() {
+    return global_pass_count;
+}
+
+passId getGlobalPass(int i) {
+    return global_passes[i];
+}
+
+/********************************************************************/
+void enablePassStatistics() {
+    statistics_enabled = 1;
+}
+
+int arePassStatisticsEnabled() {
+    return statistics_enabled;
+}
+
+/* The clock is only read with -stats, as the forward passes take it around every
+ quadruple. */
+double startPassClock() {
+    struct timespec now;
+    if (!statistics_enabled) {
+        return 0.0;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec * 1e-9;
+}
+
+void stopPassClock(passId pass, double start) {
+    if (statistics_enabled) {
+        getOptimizerContext()->statistics[pass].seconds += startPassClock() - start;
+    }
+}
+
+void countPassRemovals(passId pass, long count) {
+    getOptimizerContext()->statistics[pass].removed += count;
+}
+
+void countPassRewrites(passId pass, long count) {
+    getOptimizerContext()->statistics[pass].rewritten += count;
+}
+
+void notePassTableSize(passId pass, long size) {
+    passStatistics *statistics = &getOptimizerContext()->statistics[pass];
+    if (size > statistics->peak_size) {
+        statistics->peak_size = size;
+    }
+}
+
+static long countLiveQuadruples() {
+    quadrupleQueue *queue = &getOptimizerContext()->queue;
+    return queue->size - queue->removed_count;
+}
+
+// Runs the global passes on the partition of the calling thread.
+void runGlobalPasses(int register_count) {
+    int i;
+    for (i = 0; i < global_pass_count; i++) {
+        passId pass = global_passes[i];
+        long before = countLiveQuadruples();
+        double start = startPassClock();
+
+        switch (pass) {
+            case CONSOLIDATE_PASS:
+                runRedundancyConsolidation();
+                break;
+            case DCE_PASS:
+                runDeadCodeElimination();
+                break;
+            case SSA_PASS:
+                /* The SSA pass does its own copy propagation and dead code elimination. */
+                runSSAOptimizations();
+                break;
+            case REGALLOC_PASS:
+                countPassRewrites(pass, allocateTemporaries(register_count));
+                break;
+            default:
+                break;
+        }
+        stopPassClock(pass, start);
+        countPassRemovals(pass, before - countLiveQuadruples());
+        notePassTableSize(pass, before);
+    }
+}
+
+/* Prints the statistics summed over the contexts; the peak sizes are the largest
+ of any partition. Passes that were not selected are left out. */
+void fprintfPassStatistics(FILE *f, struct optimizerContext **contexts, int context_count) {
+    int pass, c;
+
+    fprintf(f, "%-12s %10s %10s %10s %10s\n", "pass", "seconds", "removed", "rewritten", "peak size");
+    for (pass = 0; pass < PASS_COUNT; pass++) {
+        passStatistics total = {0.0, 0, 0, 0};
+        if (!enabled[pass]) {
+            continue;
+        }
+        for (c = 0; c < context_count; c++) {
+            passStatistics *statistics = &contexts[c]->statistics[pass];
+            total.seconds += statistics->seconds;
+            total.removed += statistics->removed;
+            total.rewritten += statistics->rewritten;
+            if (statistics->peak_size > total.peak_size) {
+                total.peak_size = statistics->peak_size;
+            }
+        }
+        fprintf(f, "%-12s %10.4f %10ld %10ld %10ld\n", pass_names[pass], total.seconds, total.removed,
+                total.rewritten, total.peak_size);
+    }
+}
@@ -0,0 +1,53 @@
+#ifndef PASSES_H
+#define PASSES_H
+
+#include <stdio.h>
+
+struct optimizerContext;
+
+/* The pass manager. There are two kinds of passes:
+
+   forward  copyprop, simplify (constant folding and algebraic identities) and
+            cse run on every quadruple while the program is parsed, always in
+            that order; processQuadruple() skips those that are not selected.
+   global   consolidate, dce, ssa and regalloc run on each partition after the
+            parse, in the order they are listed, and may be listed more than once.
+
+ -passes=a,b,c replaces the default pipeline, which is every forward pass followed
+ by consolidate,dce (ssa with -ssa, then regalloc with -registers=n). With -stats
+ each pass is timed and its counts are summed over the partitions and printed to
+ stderr: the quadruples it removed, those it rewrote (operands replaced, or the
+ quadruple changed in place), and the peak size of its table (the copy table, the
+ value numbers, or the live quadruples of the queue for a global pass). */
+
+typedef enum passId {
+    COPYPROP_PASS, SIMPLIFY_PASS, CSE_PASS,
+    CONSOLIDATE_PASS, DCE_PASS, SSA_PASS, REGALLOC_PASS,
+    PASS_COUNT
+} passId;
+
+typedef struct passStatistics {
+    double seconds;
+    long removed;
+    long rewritten;
+    long peak_size;
+} passStatistics;
+
+void selectPasses(char *list);
+int isPassEnabled(passId pass);
+char *getPassName(passId pass);
+int getGlobalPassCount();
+passId getGlobalPass(int i);
+
+void enablePassStatistics();
+int arePassStatisticsEnabled();
+double startPassClock();
+void stopPassClock(passId pass, double start);
+void countPassRemovals(passId pass, long count);
+void countPassRewrites(passId pass, long count);
+void notePassTableSize(passId pass, long size);
+
+void runGlobalPasses(int register_count);
+void fprintfPassStatistics(FILE *f, struct optimizerContext **contexts, int context_count);
+
+#endif
@@ -2,213 +2,287 @@
 #include <stdlib.h>
 #include <string.h>
 #include "quadruple.h"
+#include "context.h"
 #include "misc.h"
 
-static quadrupleQueue *quad_queue = NULL;
+/* The word size of the IR. Set once before the program is read, so the threads
+ only read it. */
+static int word_size = 32;
+static int word_shift = 64 - 32;    /* the bits above the word in a constantValue */
 
-quadruple makeQuadruple(char *lhs, operator op, char *op1, char *op2) {
-    quadruple q;
-    q.lhs = stringDuplicate(lhs);
-    q.operation = op;
-    q.operand1 = stringDuplicate(op1);
-    q.operand2 = stringDuplicate(op2);
-    return q;
+operand makeVariableOperand(symbolId s) {
+    operand op;
+    op.kind = VARIABLE_OPERAND;
+    op.value = s;
+    return op;
 }
 
-quadruple* duplicateQuadruple(quadruple quad) {
-    quadruple *q = malloc(sizeof(quadruple));
-    q->lhs = stringDuplicate(quad.lhs);
-    q->operation = quad.operation;
-    q->operand1 = stringDuplicate(quad.operand1);
-    q->operand2 = stringDuplicate(quad.operand2);
-    
-    return q;
+// The constant is wrapped to the word size, so equal words are equal operands.
+operand makeConstantOperand(constantValue constant) {
+    operand op;
+    op.kind = CONSTANT_OPERAND;
+    op.value = wrapConstant(constant);
+    return op;
+}
+
+operand makeNoOperand() {
+    operand op;
+    op.kind = NO_OPERAND;
+    op.value = 0;
+    return op;
+}
+
+int isEqualOperand(operand op1, operand op2) {
+    return op1.kind == op2.kind && op1.value == op2.value;
+}
+
+// Returns 1 if op is the variable s.
+int isVariableOperand(operand op, symbolId s) {
+    return op.kind == VARIABLE_OPERAND && (symbolId)op.value == s;
 }
 
-void freeQuadruple(quadruple q) {
-    free(q.lhs);
-    free(q.operand1);
-    free(q.operand2);
+// A negative constant keeps its sign; both parsers read "-digits" as an operand.
+void fprintfOperand(FILE *f, operand op) {
+    if (op.kind == VARIABLE_OPERAND) {
+        fprintf(f, "%s", getSymbolName(op.value));
+    }
+    else {
+        fprintf(f, "%lld", op.value);
+    }
+}
+
+quadruple makeQuadruple(symbolId lhs, operator op, operand op1, operand op2) {
+    quadruple q;
+    q.lhs = lhs;
+    q.operation = op;
+    q.operand1 = op1;
+    q.operand2 = op2;
+    return q;
 }
 
 void fprintfQuadruple(FILE *f, quadruple q) {
-    fprintf(f, "%s=", q.lhs);
-    fprintf(f, "%s", q.operand1);
+    switch (q.operation) {
+        case LABELOP:
+            fprintf(f, "%s:", getSymbolName(q.lhs));
+            return;
+        case FUNCTIONOP:
+            fprintf(f, "function %s:", getSymbolName(q.lhs));
+            return;
+        case GOTOOP:
+            fprintf(f, "goto %s;", getSymbolName(q.lhs));
+            return;
+        case IFGOTOOP:
+            fprintf(f, "if ");
+            fprintfOperand(f, q.operand1);
+            fprintf(f, " goto %s;", getSymbolName(q.lhs));
+            return;
+        default:
+            break;
+    }
+    fprintf(f, "%s=", getSymbolName(q.lhs));
+    fprintfOperand(f, q.operand1);
     switch (q.operation) {
         case ASSIGNMENT: break;
         case PLUSOP    : fprintf(f, "+"); break;
         case MINUSOP   : fprintf(f, "-"); break;
         case TIMESOP   : fprintf(f, "*"); break;
         case DIVOP     : fprintf(f, "/"); break;
+        case SHIFTLEFTOP : fprintf(f, "<<"); break;
+        case SHIFTRIGHTOP: fprintf(f, ">>"); break;
+        default        : break;
     }
     if (q.operation != ASSIGNMENT) {
-        fprintf(f, "%s", q.operand2);
+        fprintfOperand(f, q.operand2);
     }
     fprintf(f, ";");
 }
 
 int isEqualQuadruple(quadruple quad1, quadruple quad2) {
-    if (strcmp(quad1.lhs, quad2.lhs) != 0) {
-        return 0;
-    }
-    if (quad1.operation != quad2.operation) {
-        return 0;
-    }
-    if (strcmp(quad1.operand1, quad2.operand2) != 0) {
-        return 0;
+    return quad1.lhs == quad2.lhs && quad1.operation == quad2.operation &&
+           isEqualOperand(quad1.operand1, quad2.operand1) &&
+           isEqualOperand(quad1.operand2, quad2.operand2);
+}
+
+// Sets the word size of the IR (-wordsize=n): 8, 16, 32 or 64 bits.
+void setWordSize(int bits) {
+    if (bits != 8 && bits != 16 && bits != 32 && bits != 64) {
+        abortMessage("Error: the word size must be 8, 16, 32 or 64 bits, not %d.", bits);
     }
-    if (strcmp(quad1.operand2, quad2.operand2) != 0) {
-        return 0;
+    word_size = bits;
+    word_shift = 64 - bits;
+}
+
+int getWordSize() {
+    return word_size;
+}
+
+/* Reduces constant modulo 2^word size and sign-extends the word again: the
+ wraparound of the IR. Done on the unsigned bits, so it never overflows. */
+constantValue wrapConstant(constantValue constant) {
+    return (constantValue)((unsigned long long)constant << word_shift) >> word_shift;
+}
+
+/* Returns 1 if quad can be folded at compile time: both operands are constants,
+ and it is not a division by zero, which is left to fail when it runs. */
+int isFoldableQuadruple(quadruple quad) {
+    return quad.operand1.kind == CONSTANT_OPERAND && quad.operand2.kind == CONSTANT_OPERAND &&
+           !(quad.operation == DIVOP && quad.operand2.value == 0);
+}
+
+// Folds a quadruple whose operands are both constants.
+constantValue calculateQuadruple(quadruple quad) {
+    return calculateOperation(quad.operation, quad.operand1.value, quad.operand2.value);
+}
+
+/* The arithmetic of the IR, shared by constant folding and the interpreter. The
+ operands are words (see wrapConstant()); +, - and * are done on unsigned bits and
+ wrapped, as is the one division that overflows, the smallest word divided by -1. */
+constantValue calculateOperation(operator operation, constantValue operand1, constantValue operand2) {
+    unsigned long long result;
+    switch(operation) {
+        case PLUSOP:
+            result = (unsigned long long)operand1 + (unsigned long long)operand2;
+            break;
+        case MINUSOP:
+            result = (unsigned long long)operand1 - (unsigned long long)operand2;
+            break;
+        case TIMESOP:
+            result = (unsigned long long)operand1 * (unsigned long long)operand2;
+            break;
+        case DIVOP:
+            if (operand2 == 0) {
+                fprintf(stderr, "Error: division by zero!\n");
+                exit(EXIT_FAILURE);
+            }
+            if (operand2 == -1) {
+                result = 0 - (unsigned long long)operand1;
+                break;
+            }
+            return operand1 / operand2;
+        case SHIFTLEFTOP:
+            result = (unsigned long long)operand1 << (operand2 & (word_size - 1));
+            break;
+        case SHIFTRIGHTOP:
+            return operand1 >> (operand2 & (word_size - 1));
+        default:
+            fprintf(stderr, "Unknown error.\n");
+            exit(EXIT_FAILURE);
+            break;
     }
-    
-    return 1;
+    return wrapConstant((constantValue)result);
+}
+
+static void resizeQuadrupleQueue() {
+    quadrupleQueue *queue = &getOptimizerContext()->queue;
+    queue->allocated_size = (queue->allocated_size == 0 ? 64 : 2 * queue->allocated_size);
+    queue->entries = safeRealloc(queue->entries, queue->allocated_size * sizeof(quadrupleEntry));
 }
 
 void initializeQuadrupleQueue() {
     destroyQuadrupleQueue();
-    quad_queue = NULL;
 }
 
-quadrupleQueue* getQuadrupleQueuePointer() {
-    return quad_queue;
+int getQuadrupleQueueSize() {
+    quadrupleQueue *queue = &getOptimizerContext()->queue;
+    return queue->size;
 }
 
-void destroyQuadrupleQueue() {
-    if (quad_queue != NULL) {
-        quadrupleQueue *next_ptr = quad_queue->next;
-        
-        while (next_ptr != NULL) {
-            freeQuadruple(*quad_queue->quad);
-            free(quad_queue);
-            quad_queue = next_ptr;
-            next_ptr = quad_queue->next;
-        }
-        
-        freeQuadruple(*quad_queue->quad);
-        free(quad_queue);
+// The returned pointer is only valid until the next insertion or compaction.
+quadrupleEntry* getQuadrupleEntry(int index) {
+    quadrupleQueue *queue = &getOptimizerContext()->queue;
+    if (index < 0 || index >= queue->size) {
+        fprintf(stderr, "Error: Queue index \"%d\" out of bounds.\n", index);
+        exit(EXIT_FAILURE);
     }
+    return &queue->entries[index];
+}
+
+void destroyQuadrupleQueue() {
+    quadrupleQueue *queue = &getOptimizerContext()->queue;
+    free(queue->entries);
+    queue->entries = NULL;
+    queue->size = 0;
+    queue->allocated_size = 0;
+    queue->removed_count = 0;
+    queue->version++;
 }
 
 // Returns the index of the new insertion
 int insertQuadrupleInQueue(quadruple quad) {
-    quadrupleQueue *queue_ptr = quad_queue;
-    int index = 0;
-    
-    if (queue_ptr == NULL) {
-        queue_ptr = malloc(sizeof(quadrupleQueue));
-        quad_queue = queue_ptr;
+    quadrupleQueue *queue = &getOptimizerContext()->queue;
+    if (queue->size == queue->allocated_size) {
+        resizeQuadrupleQueue();
     }
-    else {
-        while (queue_ptr->next != NULL) {
-            queue_ptr = queue_ptr->next;
-            index++;
-        }
-        queue_ptr->next = malloc(sizeof(quadrupleQueue));
-        queue_ptr = queue_ptr->next;
-    }
-    
-    queue_ptr->quad = duplicateQuadruple(quad);
-    queue_ptr->removed_quadruple = 0;
-    queue_ptr->rhs_index_consolidation = -1;
-    
-    queue_ptr->next = NULL;
-    
-    return index;
-}
-
-/*
- void removeQuadrupleFromQueue(quadruple quad) {
- quadrupleQueue *queue_ptr = quad_queue;
- 
- if (queue_ptr != NULL) {
- // First element of the queue
- if (isEqualQuadruple(quad, *queue_ptr->quad)) {
- quad_queue = queue_ptr->next;
- freeQuadruple(*queue_ptr->quad);
- free(queue_ptr);
- }
- else {
- while (queue_ptr->next != NULL) {
- if (isEqualQuadruple(quad, *queue_ptr->next->quad)) {
- quadrupleQueue *next_next_ptr = queue_ptr->next->next;
- freeQuadruple(*queue_ptr->next->quad);
- free(queue_ptr->next);
- queue_ptr->next = next_next_ptr;
- }
- queue_ptr = queue_ptr->next;
- }
- }
- }
- }
- */
 
-void removeQuadrupleFromQueueWithIndex(int index) {
-    int i = 0;
-    quadrupleQueue *queue_ptr = quad_queue;
-    
-    while (i!=index && queue_ptr != NULL) {
-        queue_ptr = queue_ptr->next;
-        i++;
-    }
-    
-    if (i == index) {
-        // Mark quadruple as removed.
-        queue_ptr->removed_quadruple = 1;
+    quadrupleEntry *entry = &queue->entries[queue->size];
+    entry->quad = quad;
+    entry->removed_quadruple = 0;
+    queue->version++;
+
+    addPartitionSymbol(quad.lhs);
+    if (quad.operand1.kind == VARIABLE_OPERAND) {
+        addPartitionSymbol(quad.operand1.value);
     }
-    else {
-        fprintf(stderr, "Error: Queue index \"%d\" out of bounds.\n", index);
-        exit(EXIT_FAILURE);
+    if (quad.operand2.kind == VARIABLE_OPERAND) {
+        addPartitionSymbol(quad.operand2.value);
     }
+
+    return queue->size++;
 }
 
-int getQuadrupleIndex(quadruple quad) {
-    int i = 0;
-    quadrupleQueue *queue_ptr = quad_queue;
-    
-    while (queue_ptr != NULL) {
-        if (isEqualQuadruple(quad, *queue_ptr->quad)) {
-            return i;
-        }
-        i++;
-        queue_ptr = queue_ptr->next;
+void removeQuadrupleFromQueueWithIndex(int index) {
+    quadrupleQueue *queue = &getOptimizerContext()->queue;
+    quadrupleEntry *entry = getQuadrupleEntry(index);
+
+    // Mark quadruple as removed; the slot is reclaimed by compactQuadrupleQueue().
+    if (!entry->removed_quadruple) {
+        entry->removed_quadruple = 1;
+        queue->removed_count++;
+        queue->version++;
     }
-    
-    return -1;
 }
 
-quadrupleQueue* getQuadrupleQueuePtrFromIndex(int index) {
-    int i=0;
-    quadrupleQueue *queue_ptr = quad_queue;
-    
-    while (queue_ptr != NULL && i < index) {
-        queue_ptr = queue_ptr->next;
-        i++;
+/* Drop the tombstones, keeping the program order. Indices change, so this may only be
+ called between passes. Returns the number of entries reclaimed. */
+int compactQuadrupleQueue() {
+    quadrupleQueue *queue = &getOptimizerContext()->queue;
+    int reclaimed = queue->removed_count;
+    if (reclaimed == 0) {
+        return 0;
     }
-    return queue_ptr;
-}
 
-// given the index of a quadruple, remove all the consolidations (it should actually be only 1) of other quadruples with the rhs of this quadruple
-void removeConsolidationScheduleFromIndex(int index) {
-    quadrupleQueue *queue_ptr = quad_queue;
-    
-    while (queue_ptr != NULL) {
-        if (queue_ptr->rhs_index_consolidation == index) {
-            queue_ptr->rhs_index_consolidation = -1;
+    int i, size = 0;
+    for (i = 0; i < queue->size; i++) {
+        if (!queue->entries[i].removed_quadruple) {
+            queue->entries[size++] = queue->entries[i];
         }
-        
-        queue_ptr = queue_ptr->next;
     }
+
+    queue->size = size;
+    queue->removed_count = 0;
+    queue->version++;
+    return reclaimed;
 }
 
+int getQuadrupleIndex(quadruple quad) {
+    quadrupleQueue *queue = &getOptimizerContext()->queue;
+    int i;
+    for (i = 0; i < queue->size; i++) {
+        if (isEqualQuadruple(quad, queue->entries[i].quad)) {
+            return i;
+        }
+    }
+
+    return -1;
+}
 
 void fprintfQuadrupleQueue(FILE *f) {
-    quadrupleQueue *queue_ptr = quad_queue;
-    
-    while (queue_ptr != NULL) {
-        if (!queue_ptr->removed_quadruple) {
-            fprintfQuadruple(f, *queue_ptr->quad);
+    quadrupleQueue *queue = &getOptimizerContext()->queue;
+    int i;
+    for (i = 0; i < queue->size; i++) {
+        if (!queue->entries[i].removed_quadruple) {
+            fprintfQuadruple(f, queue->entries[i].quad);
             fprintf(f, "\n");
         }
-        queue_ptr = queue_ptr->next;
     }
 }
@@ -2,43 +2,87 @@
 #define QUADRUPLE_H
 
 #include <stdio.h>
+#include "symtab.h"
 
 typedef enum operator {
-    ASSIGNMENT, PLUSOP, MINUSOP, TIMESOP, DIVOP
+    ASSIGNMENT, PLUSOP, MINUSOP, TIMESOP, DIVOP,
+    SHIFTLEFTOP, SHIFTRIGHTOP, /* the shift count is taken modulo the word size; >> keeps the sign */
+    LABELOP,   /* lhs: */
+    GOTOOP,    /* goto lhs; */
+    IFGOTOOP,  /* if operand1 goto lhs; jumps if operand1 is not 0 */
+    FUNCTIONOP /* function lhs: starts an independent part of the program */
 } operator;
 
+/* A constant of the IR. The program computes with signed words of 8, 16, 32 or 64
+ bits (-wordsize=n, 32 by default) that wrap around on overflow; a constant holds
+ such a word sign-extended to 64 bits, so two constants are equal only if their
+ words are. */
+typedef long long constantValue;
+
+typedef enum operandKind {
+    NO_OPERAND, VARIABLE_OPERAND, CONSTANT_OPERAND
+} operandKind;
+
+typedef struct operand {
+    operandKind kind;
+    constantValue value; /* symbol id if VARIABLE_OPERAND, the constant if CONSTANT_OPERAND */
+} operand;
+
 typedef struct quadruple {
-    char *lhs;
+    symbolId lhs;
     operator operation;
-    char *operand1;
-    char *operand2; /* not used if operation == ASSIGNMENT */
+    operand operand1;
+    operand operand2; /* NO_OPERAND if operation == ASSIGNMENT */
 } quadruple;
 
-typedef struct quadrupleQueue {
-    quadruple *quad;
+/* Labels, jumps and function markers keep a name in lhs, but define no variable. */
+#define definesVariable(q) ((q).operation <= SHIFTRIGHTOP)
+#define isJump(q) ((q).operation == GOTOOP || (q).operation == IFGOTOOP)
+
+/* One slot of the quadruple queue. The queue is a contiguous array indexed from 0
+ in program order; removed quadruples stay in place as tombstones until the next
+ compactQuadrupleQueue(). */
+typedef struct quadrupleEntry {
+    quadruple quad;
     int removed_quadruple;
-    int rhs_index_consolidation;
-    
-    struct quadrupleQueue *next;
+} quadrupleEntry;
+
+/* The queue of one optimizer context (see context.h). */
+typedef struct quadrupleQueue {
+    quadrupleEntry *entries;
+    int size;            /* number of entries, tombstones included */
+    int allocated_size;  /* allocated number of entries */
+    int removed_count;   /* number of tombstones */
+    int version;         /* changed by every insertion, removal and compaction */
 } quadrupleQueue;
 
-quadruple makeQuadruple(char *lhs, operator op, char *op1, char *op2);
-quadruple* duplicateQuadruple(quadruple quad);
-void freeQuadruple(quadruple q);
+operand makeVariableOperand(symbolId s);
+operand makeConstantOperand(constantValue constant);
+operand makeNoOperand();
+int isEqualOperand(operand op1, operand op2);
+int isVariableOperand(operand op, symbolId s);
+void fprintfOperand(FILE *f, operand op);
+
+quadruple makeQuadruple(symbolId lhs, operator op, operand op1, operand op2);
 void fprintfQuadruple(FILE *f, quadruple q);
 
 int isEqualQuadruple(quadruple quad1, quadruple quad2);
+void setWordSize(int bits);
+int getWordSize();
+constantValue wrapConstant(constantValue constant);
+int isFoldableQuadruple(quadruple quad);
+constantValue calculateQuadruple(quadruple quad);
+constantValue calculateOperation(operator operation, constantValue operand1, constantValue operand2);
 
 // Queue operations for quadruples
 void initializeQuadrupleQueue();
-quadrupleQueue* getQuadrupleQueuePointer();
+int getQuadrupleQueueSize();
+quadrupleEntry* getQuadrupleEntry(int index);
 int insertQuadrupleInQueue(quadruple quad);
-void removeQuadrupleFromQueue(quadruple quad);
 void removeQuadrupleFromQueueWithIndex(int index);
+int compactQuadrupleQueue();
 void destroyQuadrupleQueue();
 int getQuadrupleIndex(quadruple quad);
-quadrupleQueue* getQuadrupleQueuePtrFromIndex(int index);
-void removeConsolidationScheduleFromIndex(int index);
 void fprintfQuadrupleQueue(FILE *f);
 
 #endif
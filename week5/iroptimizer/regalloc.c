@@ -0,0 +1,239 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "misc.h"
+#include "intset.h"
+#include "quadruple.h"
+#include "deadcode.h"
+#include "cfg.h"
+#include "dataflow.h"
+#include "context.h"
+#include "regalloc.h"
+
+typedef struct liveInterval {
+    symbolId temp;
+    int start;          /* queue index of the first quadruple it is live at */
+    int end;            /* queue index of the last one */
+    int location;       /* register, or spill slot if spilled */
+    int spilled;
+} liveInterval;
+
+static int compareIntervalStarts(const void *a, const void *b) {
+    const liveInterval *i1 = *(liveInterval * const *)a, *i2 = *(liveInterval * const *)b;
+    if (i1->start != i2->start) {
+        return i1->start < i2->start ? -1 : 1;
+    }
+    return i1->temp < i2->temp ? -1 : (i1->temp > i2->temp);
+}
+
+/* Inserts interval into active, which is sorted by end. */
+static void activateInterval(liveInterval **active, int *active_count, liveInterval *interval) {
+    int i = *active_count;
+    while (i > 0 && active[i - 1]->end > interval->end) {
+        active[i] = active[i - 1];
+        i--;
+    }
+    active[i] = interval;
+    (*active_count)++;
+}
+
+/* The linear scan over intervals, sorted by start. At most limit locations are
+ used (no limit if limit is 0); an interval that does not fit is marked spilled.
+ An interval that ends where the next one starts can share its location, since a
+ quadruple reads its operands before it writes its result. Returns the number of
+ locations used. */
+static int scanIntervals(liveInterval **intervals, int count, int limit) {
+    liveInterval **active = safeMalloc((count + 1) * sizeof(liveInterval *));
+    int *free_locations = safeMalloc((count + 1) * sizeof(int));
+    int active_count = 0, free_count = 0, used = 0, i, j;
+
+    for (i = 0; i < count; i++) {
+        liveInterval *interval = intervals[i];
+
+        for (j = 0; j < active_count && active[j]->end <= interval->start; j++) {
+            free_locations[free_count++] = active[j]->location;
+        }
+        active_count -= j;
+        memmove(active, active + j, active_count * sizeof(liveInterval *));
+
+        if (limit > 0 && active_count == limit) {
+            /* Spill whichever of the two stays live longest. */
+            liveInterval *longest = active[active_count - 1];
+            if (longest->end > interval->end) {
+                interval->location = longest->location;
+                longest->spilled = 1;
+                active_count--;
+                activateInterval(active, &active_count, interval);
+            }
+            else {
+                interval->spilled = 1;
+            }
+            continue;
+        }
+        interval->location = (free_count > 0 ? free_locations[--free_count] : used++);
+        activateInterval(active, &active_count, interval);
+    }
+
+    free(free_locations);
+    free(active);
+    return used;
+}
+
+// The interval of var, or -1 if it keeps its name; var need not be in the partition.
+static int intervalOf(int *interval_of, symbolId var) {
+    int index = getPartitionSymbolIndex(var);
+    return (index == -1 ? -1 : interval_of[index]);
+}
+
+// Widens the intervals to the blocks that the temporaries are live into or out of.
+static void extendToBlocks(controlFlowGraph *cfg, dataflowSolution liveness, int *interval_of,
+                           liveInterval *intervals) {
+    int b, var, interval;
+    for (b = 0; b < cfg->block_count; b++) {
+        basicBlock *block = &cfg->blocks[b];
+        for (var = nextMemberIntSet(liveness.in[b], 0); var != -1; var = nextMemberIntSet(liveness.in[b], var + 1)) {
+            interval = intervalOf(interval_of, var);
+            if (interval >= 0 && intervals[interval].start > block->first) {
+                intervals[interval].start = block->first;
+            }
+        }
+        for (var = nextMemberIntSet(liveness.out[b], 0); var != -1; var = nextMemberIntSet(liveness.out[b], var + 1)) {
+            interval = intervalOf(interval_of, var);
+            if (interval >= 0 && intervals[interval].end < block->last) {
+                intervals[interval].end = block->last;
+            }
+        }
+    }
+}
+
+static void addToInterval(liveInterval *intervals, int *interval_of, int *interval_count, symbolId var, int index) {
+    int var_index = getPartitionSymbolIndex(var);
+    if (interval_of[var_index] == -1) {
+        return;
+    }
+    if (interval_of[var_index] == -2) {
+        liveInterval *interval = &intervals[*interval_count];
+        interval->temp = var;
+        interval->start = interval->end = index;
+        interval->location = -1;
+        interval->spilled = 0;
+        interval_of[var_index] = (*interval_count)++;
+        return;
+    }
+    liveInterval *interval = &intervals[interval_of[var_index]];
+    if (interval->end < index) {
+        interval->end = index;
+    }
+}
+
+/* Names for count locations: _1, _2, ... in order, skipping the names of the
+ temporaries that keep their own. */
+static symbolId *makeLocationNames(int count, intSet kept) {
+    symbolId *names = safeMalloc((count + 1) * sizeof(symbolId));
+    int i, n = 1;
+    for (i = 0; i < count; i++) {
+        do {
+            names[i] = internTemporarySymbol(&n);
+        } while (isMemberIntSet(names[i], kept));
+    }
+    return names;
+}
+
+static void renameOperand(operand *op, int *interval_of, liveInterval *intervals, symbolId *names) {
+    if (op->kind == VARIABLE_OPERAND && intervalOf(interval_of, op->value) >= 0) {
+        op->value = names[intervals[intervalOf(interval_of, op->value)].location];
+    }
+}
+
+int allocateTemporaries(int register_count) {
+    int size, symbol_count = getPartitionSymbolCount();
+    int i;
+
+    compactQuadrupleQueue();
+    size = getQuadrupleQueueSize();
+    controlFlowGraph *cfg = buildControlFlowGraph();
+    intSet live_at_exit = getLiveAtExit();
+    dataflowSolution liveness = computeLiveness(cfg, live_at_exit);
+
+    /* interval_of, by getPartitionSymbolIndex(): -1 if the symbol keeps its name,
+     -2 for a temporary without an interval yet, the interval otherwise. Temporaries
+     that are live on entry or at the exit are read or seen outside, so they keep
+     their names. */
+    symbolId *symbols = getPartitionSymbols();
+    char *is_temporary = safeMalloc(symbol_count + 1);
+    int *interval_of = safeMalloc((symbol_count + 1) * sizeof(int));
+    intSet kept = makeEmptyIntSet();
+    classifySymbols(symbols, symbol_count, is_temporary, NULL);
+    for (i = 0; i < symbol_count; i++) {
+        symbolId var = symbols[i];
+        interval_of[i] = -1;
+        if (is_temporary[i]) {
+            if (isMemberIntSet(var, liveness.in[0]) || isMemberIntSet(var, live_at_exit)) {
+                insertIntSet(var, &kept);
+            }
+            else {
+                interval_of[i] = -2;
+            }
+        }
+    }
+    free(is_temporary);
+
+    liveInterval *intervals = safeMalloc((symbol_count + 1) * sizeof(liveInterval));
+    int interval_count = 0;
+    for (i = 0; i < size; i++) {
+        quadruple *quad = &getQuadrupleEntry(i)->quad;
+        if (definesVariable(*quad)) {
+            addToInterval(intervals, interval_of, &interval_count, quad->lhs, i);
+        }
+        if (quad->operand1.kind == VARIABLE_OPERAND) {
+            addToInterval(intervals, interval_of, &interval_count, quad->operand1.value, i);
+        }
+        if (quad->operand2.kind == VARIABLE_OPERAND) {
+            addToInterval(intervals, interval_of, &interval_count, quad->operand2.value, i);
+        }
+    }
+    extendToBlocks(cfg, liveness, interval_of, intervals);
+
+    /* Registers first; the spilled intervals then get the spill slots after them. */
+    liveInterval **order = safeMalloc((interval_count + 1) * sizeof(liveInterval *));
+    for (i = 0; i < interval_count; i++) {
+        order[i] = &intervals[i];
+    }
+    qsort(order, interval_count, sizeof(liveInterval *), compareIntervalStarts);
+    int registers_used = scanIntervals(order, interval_count, register_count);
+    int spill_count = 0;
+    for (i = 0; i < interval_count; i++) {
+        if (order[i]->spilled) {
+            order[spill_count++] = order[i];
+        }
+    }
+    int slots_used = scanIntervals(order, spill_count, 0);
+    for (i = 0; i < spill_count; i++) {
+        order[i]->location += registers_used;
+    }
+
+    symbolId *names = makeLocationNames(registers_used + slots_used, kept);
+    for (i = 0; i < size; i++) {
+        quadruple *quad = &getQuadrupleEntry(i)->quad;
+        if (definesVariable(*quad) && intervalOf(interval_of, quad->lhs) >= 0) {
+            quad->lhs = names[intervals[intervalOf(interval_of, quad->lhs)].location];
+        }
+        renameOperand(&quad->operand1, interval_of, intervals, names);
+        renameOperand(&quad->operand2, interval_of, intervals, names);
+    }
+    // The renaming bypassed the queue, so the partition learns the names here.
+    for (i = 0; i < registers_used + slots_used; i++) {
+        addPartitionSymbol(names[i]);
+    }
+
+    free(names);
+    free(order);
+    free(intervals);
+    freeIntSet(kept);
+    free(interval_of);
+    freeDataflowSolution(liveness);
+    freeIntSet(live_at_exit);
+    destroyControlFlowGraph(cfg);
+
+    return interval_count;
+}
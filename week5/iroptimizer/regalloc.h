@@ -0,0 +1,19 @@
+#ifndef REGALLOC_H
+#define REGALLOC_H
+
+/* Linear scan allocation of the compiler temporaries (the names the passes create,
+ see internTemporarySymbol()) after the global passes. Every temporary gets a live interval over the queue
+ indices: from its first definition or use to its last, widened to whole blocks
+ where liveness says it is live on entry or exit, so loops are covered. The
+ intervals are scanned by start; a temporary takes a free register, or, when all
+ register_count registers are taken, the interval that ends last is spilled.
+ Spilled temporaries share spill slots by the same scan without a limit.
+
+ The first register_count names of _1, _2, ... that the program does not use are
+ the registers and the names after them the spill slots, so every spilled
+ temporary is marked by its name. Temporaries that are live on entry or at the
+ exit keep their names, and those names are skipped. Returns the number of temporaries that were allocated. */
+
+int allocateTemporaries(int register_count);
+
+#endif
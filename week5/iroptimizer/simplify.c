@@ -0,0 +1,238 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "misc.h"
+#include "symbolmap.h"
+#include "simplify.h"
+
+/* var = base + constant (PLUSOP) or var = base * constant (TIMESOP). */
+typedef struct chain {
+    symbolId base;
+    int base_index;     /* the map index of base */
+    operator operation;
+    unsigned long long constant;    /* the bits of the word; wrapped when it becomes an operand */
+    int version;        /* the version of var the chain was recorded with */
+    int base_version;   /* the version of base at that point */
+    int epoch;          /* the chain is dropped when the table is cleared */
+} chain;
+
+struct chainTable {
+    symbolMap map;      /* numbers the variables the table has seen */
+    chain *chains;      /* indexed by map index */
+    int *versions;      /* indexed by map index: the number of definitions so far */
+    int size;
+    int epoch;
+};
+
+// The map index of var, which gets an entry if it has none yet.
+static int insertVariable(chainTable *table, symbolId var) {
+    int index = insertSymbolIndex(&table->map, var);
+    if (index < table->size) {
+        return index;
+    }
+    int new_size = (table->size == 0 ? 16 : 2 * table->size);
+    table->chains = safeRealloc(table->chains, new_size * sizeof(chain));
+    table->versions = safeRealloc(table->versions, new_size * sizeof(int));
+    int i;
+    for (i = table->size; i < new_size; i++) {
+        table->chains[i].epoch = -1;
+        table->versions[i] = 0;
+    }
+    table->size = new_size;
+    return index;
+}
+
+chainTable *createChainTable() {
+    chainTable *table = safeMalloc(sizeof(chainTable));
+    initializeSymbolMap(&table->map);
+    table->chains = NULL;
+    table->versions = NULL;
+    table->size = 0;
+    table->epoch = 0;
+    return table;
+}
+
+// The bits of the word that constant holds, so the smallest word is a power of two.
+static unsigned long long wordBits(constantValue constant) {
+    return (unsigned long long)constant & (~0ULL >> (64 - getWordSize()));
+}
+
+static int isPowerOfTwo(unsigned long long c) {
+    return c != 0 && (c & (c - 1)) == 0;
+}
+
+static int log2OfPowerOfTwo(unsigned long long c) {
+    int k = 0;
+    while (c > 1) {
+        c >>= 1;
+        k++;
+    }
+    return k;
+}
+
+static int isConstantOperand(operand op, constantValue constant) {
+    return op.kind == CONSTANT_OPERAND && op.value == constant;
+}
+
+/* Splits quad into var op constant, when it has that form, with the operation
+ turned into PLUSOP or TIMESOP: a subtraction adds the negated constant, and a left
+ shift multiplies by a power of two. */
+static int splitChain(quadruple quad, operand *var, operator *operation, unsigned long long *constant) {
+    operand op1 = quad.operand1, op2 = quad.operand2;
+    if ((quad.operation == PLUSOP || quad.operation == TIMESOP) && op1.kind == CONSTANT_OPERAND) {
+        op1 = quad.operand2;
+        op2 = quad.operand1;
+    }
+    if (op1.kind != VARIABLE_OPERAND || op2.kind != CONSTANT_OPERAND) {
+        return 0;
+    }
+    *var = op1;
+    switch (quad.operation) {
+        case PLUSOP:
+            *operation = PLUSOP;
+            *constant = (unsigned long long)op2.value;
+            return 1;
+        case MINUSOP:
+            *operation = PLUSOP;
+            *constant = 0 - (unsigned long long)op2.value;
+            return 1;
+        case TIMESOP:
+            *operation = TIMESOP;
+            *constant = (unsigned long long)op2.value;
+            return 1;
+        case SHIFTLEFTOP:
+            *operation = TIMESOP;
+            *constant = 1ULL << (op2.value & (getWordSize() - 1));
+            return 1;
+        default:
+            return 0;
+    }
+}
+
+static chain *lookupChain(chainTable *table, operand op) {
+    if (op.kind != VARIABLE_OPERAND) {
+        return NULL;
+    }
+    int index = findSymbolIndex(&table->map, op.value);
+    if (index == -1) {
+        return NULL;
+    }
+    chain *c = &table->chains[index];
+    if (c->epoch != table->epoch || c->version != table->versions[index] ||
+        c->base_version != table->versions[c->base_index]) {
+        return NULL;
+    }
+    return c;
+}
+
+// Rewrites var op constant in terms of the variable that var was computed from.
+static quadruple reassociate(chainTable *table, quadruple quad) {
+    operand var;
+    operator operation;
+    unsigned long long constant;
+
+    if (!splitChain(quad, &var, &operation, &constant)) {
+        return quad;
+    }
+    chain *c = lookupChain(table, var);
+    if (c == NULL || c->operation != operation) {
+        return quad;
+    }
+    if (operation == PLUSOP) {
+        constant += c->constant;
+        constantValue value = wrapConstant((constantValue)constant);
+        constantValue negated = wrapConstant((constantValue)(0 - constant));
+        if (value < 0 && negated > 0) {
+            return makeQuadruple(quad.lhs, MINUSOP, makeVariableOperand(c->base), makeConstantOperand(negated));
+        }
+        return makeQuadruple(quad.lhs, PLUSOP, makeVariableOperand(c->base), makeConstantOperand(value));
+    }
+    constant *= c->constant;
+    return makeQuadruple(quad.lhs, TIMESOP, makeVariableOperand(c->base), makeConstantOperand((constantValue)constant));
+}
+
+static quadruple makeCopy(symbolId lhs, operand op) {
+    return makeQuadruple(lhs, ASSIGNMENT, op, makeNoOperand());
+}
+
+// Removes the identities, and reduces a multiplication by a power of two to a shift.
+static quadruple applyIdentities(quadruple quad) {
+    operand op1 = quad.operand1, op2 = quad.operand2;
+    switch (quad.operation) {
+        case PLUSOP:
+            if (isConstantOperand(op1, 0)) return makeCopy(quad.lhs, op2);
+            if (isConstantOperand(op2, 0)) return makeCopy(quad.lhs, op1);
+            break;
+        case MINUSOP:
+            if (isConstantOperand(op2, 0)) return makeCopy(quad.lhs, op1);
+            if (op1.kind == VARIABLE_OPERAND && isEqualOperand(op1, op2)) {
+                return makeCopy(quad.lhs, makeConstantOperand(0));
+            }
+            break;
+        case TIMESOP:
+            if (op1.kind == CONSTANT_OPERAND) {
+                op1 = quad.operand2;
+                op2 = quad.operand1;
+            }
+            if (isConstantOperand(op2, 0)) return makeCopy(quad.lhs, op2);
+            if (isConstantOperand(op2, 1)) return makeCopy(quad.lhs, op1);
+            if (op2.kind == CONSTANT_OPERAND && isPowerOfTwo(wordBits(op2.value))) {
+                int shift = log2OfPowerOfTwo(wordBits(op2.value));
+                return makeQuadruple(quad.lhs, SHIFTLEFTOP, op1, makeConstantOperand(shift));
+            }
+            break;
+        case DIVOP:
+            if (isConstantOperand(op2, 1)) return makeCopy(quad.lhs, op1);
+            break;
+        case SHIFTLEFTOP:
+        case SHIFTRIGHTOP:
+            if (op2.kind == CONSTANT_OPERAND && (op2.value & (getWordSize() - 1)) == 0) return makeCopy(quad.lhs, op1);
+            if (isConstantOperand(op1, 0)) return makeCopy(quad.lhs, op1);
+            break;
+        default:
+            break;
+    }
+    return quad;
+}
+
+/* Simplifies a quadruple whose operands went through copy propagation and that is
+ not a constant expression; the result may be a copy. */
+quadruple simplifyQuadruple(chainTable *table, quadruple quad) {
+    if (quad.operation == ASSIGNMENT) {
+        return quad;
+    }
+    return applyIdentities(reassociate(table, quad));
+}
+
+// Call for every definition in program order, after simplifyQuadruple().
+void recordDefinition(chainTable *table, quadruple quad) {
+    operand var;
+    operator operation;
+    unsigned long long constant;
+
+    int lhs = insertVariable(table, quad.lhs);
+    table->versions[lhs]++;
+    if (!splitChain(quad, &var, &operation, &constant) || var.value == (int)quad.lhs) {
+        return;
+    }
+    int base = insertVariable(table, var.value);
+    chain *c = &table->chains[lhs];
+    c->base = var.value;
+    c->base_index = base;
+    c->operation = operation;
+    c->constant = constant;
+    c->version = table->versions[lhs];
+    c->base_version = table->versions[base];
+    c->epoch = table->epoch;
+}
+
+// Forgets all chains, e.g. at a label where other paths join.
+void clearChainTable(chainTable *table) {
+    table->epoch++;
+}
+
+void destroyChainTable(chainTable *table) {
+    destroySymbolMap(&table->map);
+    free(table->chains);
+    free(table->versions);
+    free(table);
+}
@@ -0,0 +1,27 @@
+#ifndef SIMPLIFY_H
+#define SIMPLIFY_H
+
+#include "quadruple.h"
+
+/* Algebraic simplification of the quadruples as they are parsed. Identities such
+ as x+0, x*1, x*0, x-x and x/1 are removed, and a multiplication by a power of two
+ becomes a left shift. Chains of constant additions or multiplications are
+ reassociated: after a=b+1, c=a+2 becomes c=b+3, which leaves a dead if nothing
+ else reads it. Division is not turned into a shift, because x/2 rounds towards
+ zero and x>>1 does not.
+
+ The chain table remembers, per variable, the variable and the constant it was
+ computed from. Like the copy table, it numbers the variables it has seen with a
+ symbol map of its own (see symbolmap.h). A definition bumps the version of its variable, and a chain only
+ holds while the versions of both of its variables are the ones it was recorded
+ with, so nothing has to be searched when a variable is redefined. */
+
+typedef struct chainTable chainTable;
+
+chainTable *createChainTable();
+quadruple simplifyQuadruple(chainTable *table, quadruple quad);
+void recordDefinition(chainTable *table, quadruple quad);
+void clearChainTable(chainTable *table);
+void destroyChainTable(chainTable *table);
+
+#endif
@@ -0,0 +1,490 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "misc.h"
+#include "intset.h"
+#include "quadruple.h"
+#include "deadcode.h"
+#include "cfg.h"
+#include "dataflow.h"
+#include "context.h"
+#include "ssa.h"
+
+/* An SSA value: a constant, the value a variable has on entry, or the value
+ defined by the quadruple at some index. */
+typedef enum ssaValueKind {
+    CONSTANT_VALUE, ENTRY_VALUE, DEFINITION_VALUE
+} ssaValueKind;
+
+typedef struct ssaValue {
+    ssaValueKind kind;
+    constantValue value; /* the constant, the variable or the quadruple index */
+} ssaValue;
+
+/* A pending copy dst = src at the end of the block. */
+typedef struct exitCopy {
+    symbolId dst;
+    operand src;
+} exitCopy;
+
+/* The state of one run of the pass, kept in the optimizer context. */
+typedef struct ssaPass ssaPass;
+struct ssaPass {
+    quadruple *code;               /* the quadruples of the block, without label and jump */
+    int code_size;
+
+    ssaValue *definition_value;    /* indexed by quadruple: the value it computes */
+    ssaValue *operand1_value;      /* indexed by quadruple: the values it reads */
+    ssaValue *operand2_value;
+    int *expression_table;         /* open addressing over quadruple indices, -1 is free */
+    unsigned int expression_table_size;
+
+    /* Indexed by getPartitionSymbolIndex() of the symbols the partition had before
+     the pass, and kept between blocks; resetBlock() only resets the symbols the
+     block touched. */
+    ssaValue *current;             /* after numberValues(): the value at the end of the block */
+    int *occupied_until;           /* last use of the value that a name holds */
+    int symbol_count;
+
+    intSet live_at_exit;           /* the variables live at the end of the block */
+    symbolId *exit_symbols;        /* the same, in increasing order */
+    int exit_count;
+
+    intSet used_symbols;           /* every name the partition uses */
+    int temporary_count;           /* next candidate for newTemporary() */
+};
+
+/* A temporary name that the partition does not use yet. The names are picked per
+ partition, so the output does not depend on the order the partitions run in. */
+static symbolId newTemporary() {
+    ssaPass *pass = getOptimizerContext()->ssa;
+    symbolId temp;
+    do {
+        temp = internTemporarySymbol(&pass->temporary_count);
+    } while (isMemberIntSet(temp, pass->used_symbols));
+    insertIntSet(temp, &pass->used_symbols);
+    return temp;
+}
+
+static ssaValue makeSSAValue(ssaValueKind kind, constantValue value) {
+    ssaValue v;
+    v.kind = kind;
+    v.value = value;
+    return v;
+}
+
+static int isEqualSSAValue(ssaValue v1, ssaValue v2) {
+    return v1.kind == v2.kind && v1.value == v2.value;
+}
+
+static int compareSSAValues(ssaValue v1, ssaValue v2) {
+    if (v1.kind != v2.kind) {
+        return v1.kind < v2.kind ? -1 : 1;
+    }
+    if (v1.value != v2.value) {
+        return v1.value < v2.value ? -1 : 1;
+    }
+    return 0;
+}
+
+static unsigned int hashSSAExpression(operator operation, ssaValue v1, ssaValue v2) {
+    unsigned int hash = operation;
+    hash = hash * 31 + v1.kind;
+    hash = hash * 0x9E3779B1u + (unsigned int)(v1.value ^ (v1.value >> 32));
+    hash = hash * 31 + v2.kind;
+    hash = hash * 0x9E3779B1u + (unsigned int)(v2.value ^ (v2.value >> 32));
+    return hash ^ (hash >> 16);
+}
+
+// Puts the operands of + and * in canonical order, so a+b and b+a are the same expression.
+static void canonicalizeSSAOperands(operator operation, ssaValue *v1, ssaValue *v2) {
+    if ((operation == PLUSOP || operation == TIMESOP) && compareSSAValues(*v1, *v2) > 0) {
+        ssaValue tmp = *v1;
+        *v1 = *v2;
+        *v2 = tmp;
+    }
+}
+
+static ssaValue readOperand(operand op, ssaValue *values) {
+    if (op.kind == CONSTANT_OPERAND) {
+        return makeSSAValue(CONSTANT_VALUE, op.value);
+    }
+    return values[getPartitionSymbolIndex(op.value)];
+}
+
+/* Walk the block once in order. Each variable maps to its current value, so every
+ read names the version it sees. A copy takes the value of its source, constant
+ operands are folded, and an expression already computed over the same values
+ takes the value of its first computation. */
+static void numberValues() {
+    ssaPass *pass = getOptimizerContext()->ssa;
+    int i;
+    pass->expression_table_size = 16;
+    while (pass->expression_table_size < 2 * (unsigned int)pass->code_size) {
+        pass->expression_table_size *= 2;
+    }
+    pass->expression_table = safeMalloc(pass->expression_table_size * sizeof(int));
+    for (i = 0; i < (int)pass->expression_table_size; i++) {
+        pass->expression_table[i] = -1;
+    }
+
+    for (i = 0; i < pass->code_size; i++) {
+        quadruple q = pass->code[i];
+        ssaValue v1 = readOperand(q.operand1, pass->current);
+        ssaValue v2 = makeSSAValue(CONSTANT_VALUE, 0);
+        if (q.operation != ASSIGNMENT) {
+            v2 = readOperand(q.operand2, pass->current);
+        }
+        pass->operand1_value[i] = v1;
+        pass->operand2_value[i] = v2;
+        canonicalizeSSAOperands(q.operation, &v1, &v2);
+
+        if (q.operation == ASSIGNMENT) {
+            pass->definition_value[i] = v1;
+        }
+        else if (v1.kind == CONSTANT_VALUE && v2.kind == CONSTANT_VALUE &&
+                 !(q.operation == DIVOP && v2.value == 0)) {
+            quadruple folded = makeQuadruple(q.lhs, q.operation, makeConstantOperand(pass->operand1_value[i].value),
+                                             makeConstantOperand(pass->operand2_value[i].value));
+            pass->definition_value[i] = makeSSAValue(CONSTANT_VALUE, calculateQuadruple(folded));
+        }
+        else {
+            unsigned int bucket = hashSSAExpression(q.operation, v1, v2) & (pass->expression_table_size - 1);
+            while (pass->expression_table[bucket] != -1) {
+                int j = pass->expression_table[bucket];
+                ssaValue w1 = pass->operand1_value[j], w2 = pass->operand2_value[j];
+                canonicalizeSSAOperands(pass->code[j].operation, &w1, &w2);
+                if (pass->code[j].operation == q.operation && isEqualSSAValue(w1, v1) && isEqualSSAValue(w2, v2)) {
+                    break;
+                }
+                bucket = (bucket + 1) & (pass->expression_table_size - 1);
+            }
+            if (pass->expression_table[bucket] == -1) {
+                pass->expression_table[bucket] = i;
+                pass->definition_value[i] = makeSSAValue(DEFINITION_VALUE, i);
+            }
+            else {
+                pass->definition_value[i] = makeSSAValue(DEFINITION_VALUE, pass->expression_table[bucket]);
+            }
+        }
+        pass->current[getPartitionSymbolIndex(q.lhs)] = pass->definition_value[i];
+    }
+    free(pass->expression_table);
+}
+
+/* Only quadruples that define their own value are kept; the others were replaced by
+ the value they compute. Those are live if the end of the block or a live quadruple
+ reads them, so one backward sweep finds them all. Returns the live set. */
+static char *findLiveDefinitions() {
+    ssaPass *pass = getOptimizerContext()->ssa;
+    char *live = safeMalloc(pass->code_size * sizeof(char));
+    int i;
+    for (i = 0; i < pass->code_size; i++) {
+        live[i] = 0;
+    }
+    for (i = 0; i < pass->exit_count; i++) {
+        ssaValue v = pass->current[getPartitionSymbolIndex(pass->exit_symbols[i])];
+        if (v.kind == DEFINITION_VALUE) {
+            live[v.value] = 1;
+        }
+    }
+    for (i = pass->code_size - 1; i >= 0; i--) {
+        if (live[i]) {
+            if (pass->operand1_value[i].kind == DEFINITION_VALUE) {
+                live[pass->operand1_value[i].value] = 1;
+            }
+            if (pass->code[i].operation != ASSIGNMENT && pass->operand2_value[i].kind == DEFINITION_VALUE) {
+                live[pass->operand2_value[i].value] = 1;
+            }
+        }
+    }
+    return live;
+}
+
+/* The last use of an entry value occupies the name of its variable until then. */
+static void extendLastUse(ssaValue v, int position, int *definition_last_use) {
+    ssaPass *pass = getOptimizerContext()->ssa;
+    if (v.kind == DEFINITION_VALUE && definition_last_use[v.value] < position) {
+        definition_last_use[v.value] = position;
+    }
+    else if (v.kind == ENTRY_VALUE) {
+        int *occupied_until = &pass->occupied_until[getPartitionSymbolIndex(v.value)];
+        if (*occupied_until < position) {
+            *occupied_until = position;
+        }
+    }
+}
+
+static operand valueToOperand(ssaValue v, symbolId *names) {
+    switch (v.kind) {
+        case CONSTANT_VALUE: return makeConstantOperand(v.value);
+        case ENTRY_VALUE   : return makeVariableOperand(v.value);
+        default            : return makeVariableOperand(names[v.value]);
+    }
+}
+
+/* Emit the copies dst = src that must all hold at the end of the block as if they happened at
+ once: a copy waits while another copy still reads its destination, and a cycle of
+ copies is broken through a fresh temporary. */
+static void emitExitCopies(exitCopy *copies, int count) {
+    while (count > 0) {
+        int i, j, ready = -1;
+        for (i = 0; i < count && ready == -1; i++) {
+            ready = i;
+            for (j = 0; j < count; j++) {
+                if (j != i && isVariableOperand(copies[j].src, copies[i].dst)) {
+                    ready = -1;
+                    break;
+                }
+            }
+        }
+        if (ready == -1) {
+            symbolId temp = newTemporary();
+            insertQuadrupleInQueue(makeQuadruple(temp, ASSIGNMENT, makeVariableOperand(copies[0].dst), makeNoOperand()));
+            for (j = 0; j < count; j++) {
+                if (isVariableOperand(copies[j].src, copies[0].dst)) {
+                    copies[j].src = makeVariableOperand(temp);
+                }
+            }
+            continue;
+        }
+        insertQuadrupleInQueue(makeQuadruple(copies[ready].dst, ASSIGNMENT, copies[ready].src, makeNoOperand()));
+        for (j = ready + 1; j < count; j++) {
+            copies[j - 1] = copies[j];
+        }
+        count--;
+    }
+}
+
+/* Give every live definition a name and rebuild the quadruple queue. A definition
+ gets, in order of preference, the name of a variable it is the exit value of, the
+ name of its own variable, or a fresh temporary; a name is only taken once the
+ value it holds has had its last use. The exit values that did not end up in the
+ right variable are copied there at the end. */
+static void leaveSSA(char *live) {
+    ssaPass *pass = getOptimizerContext()->ssa;
+    int *definition_last_use = safeMalloc((pass->code_size + 1) * sizeof(int));
+    symbolId *preferred_name = safeMalloc((pass->code_size + 1) * sizeof(symbolId));
+    symbolId *names = safeMalloc((pass->code_size + 1) * sizeof(symbolId));
+    int i;
+
+    for (i = 0; i < pass->code_size; i++) {
+        definition_last_use[i] = -1;
+        preferred_name[i] = pass->code[i].lhs;
+    }
+    for (i = 0; i < pass->code_size; i++) {
+        if (live[i]) {
+            extendLastUse(pass->operand1_value[i], i, definition_last_use);
+            if (pass->code[i].operation != ASSIGNMENT) {
+                extendLastUse(pass->operand2_value[i], i, definition_last_use);
+            }
+        }
+    }
+    for (i = 0; i < pass->exit_count; i++) {
+        symbolId var = pass->exit_symbols[i];
+        ssaValue exit_value = pass->current[getPartitionSymbolIndex(var)];
+        extendLastUse(exit_value, pass->code_size, definition_last_use);
+        if (exit_value.kind == DEFINITION_VALUE) {
+            int definition = exit_value.value;
+            symbolId own = pass->code[definition].lhs;
+            // Keep the own variable if it is already the right one at the end.
+            if (preferred_name[definition] == own &&
+                !(isMemberIntSet(own, pass->live_at_exit) &&
+                  isEqualSSAValue(pass->current[getPartitionSymbolIndex(own)], exit_value))) {
+                preferred_name[definition] = var;
+            }
+        }
+    }
+
+    /* Fresh temporaries are never reused, so occupied_until only tracks the symbols
+     that existed before the pass. */
+    for (i = 0; i < pass->code_size; i++) {
+        if (!live[i]) {
+            continue;
+        }
+        symbolId name = preferred_name[i];
+        if (pass->occupied_until[getPartitionSymbolIndex(name)] > i) {
+            name = pass->code[i].lhs;
+        }
+        if (pass->occupied_until[getPartitionSymbolIndex(name)] > i) {
+            name = newTemporary();
+        }
+        else {
+            pass->occupied_until[getPartitionSymbolIndex(name)] = definition_last_use[i];
+        }
+        names[i] = name;
+
+        operand op1 = valueToOperand(pass->operand1_value[i], names);
+        operand op2 = makeNoOperand();
+        if (pass->code[i].operation != ASSIGNMENT) {
+            op2 = valueToOperand(pass->operand2_value[i], names);
+        }
+        insertQuadrupleInQueue(makeQuadruple(name, pass->code[i].operation, op1, op2));
+    }
+
+    exitCopy *copies = safeMalloc((pass->exit_count + 1) * sizeof(exitCopy));
+    int count = 0;
+    for (i = 0; i < pass->exit_count; i++) {
+        operand src = valueToOperand(pass->current[getPartitionSymbolIndex(pass->exit_symbols[i])], names);
+        if (!isVariableOperand(src, pass->exit_symbols[i])) {
+            copies[count].dst = pass->exit_symbols[i];
+            copies[count].src = src;
+            count++;
+        }
+    }
+    emitExitCopies(copies, count);
+
+    free(copies);
+    free(names);
+    free(preferred_name);
+    free(definition_last_use);
+}
+
+/* A live variable that the partition does not use keeps its value without a copy,
+ so only the symbols of the partition are exit symbols. */
+static void setLiveAtExit(intSet live) {
+    ssaPass *pass = getOptimizerContext()->ssa;
+    int var, index;
+    freeIntSet(pass->live_at_exit);
+    pass->live_at_exit = live;
+    pass->exit_count = 0;
+    for (var = nextMemberIntSet(live, 0); var != -1; var = nextMemberIntSet(live, var + 1)) {
+        index = getPartitionSymbolIndex(var);
+        if (index != -1 && index < pass->symbol_count) {
+            pass->exit_symbols[pass->exit_count++] = var;
+        }
+    }
+}
+
+// Forget the values and names of the symbols the block touched.
+static void resetBlock() {
+    ssaPass *pass = getOptimizerContext()->ssa;
+    int i;
+    for (i = 0; i < pass->code_size; i++) {
+        int lhs = getPartitionSymbolIndex(pass->code[i].lhs);
+        pass->current[lhs] = makeSSAValue(ENTRY_VALUE, pass->code[i].lhs);
+        pass->occupied_until[lhs] = -1;
+        if (pass->code[i].operand1.kind == VARIABLE_OPERAND) {
+            pass->occupied_until[getPartitionSymbolIndex(pass->code[i].operand1.value)] = -1;
+        }
+        if (pass->code[i].operand2.kind == VARIABLE_OPERAND) {
+            pass->occupied_until[getPartitionSymbolIndex(pass->code[i].operand2.value)] = -1;
+        }
+    }
+    for (i = 0; i < pass->exit_count; i++) {
+        pass->occupied_until[getPartitionSymbolIndex(pass->exit_symbols[i])] = -1;
+    }
+}
+
+/* Optimize one basic block; the variables in block_live_out are read after it. The
+ label stays first and the jump last, after the copies to the live variables. */
+static void optimizeBlock(quadruple *program, basicBlock *block, intSet block_live_out) {
+    ssaPass *pass = getOptimizerContext()->ssa;
+    int first = block->first, last = block->last;
+    quadruple *terminator = NULL;
+
+    while (first < last && !definesVariable(program[first]) && !isJump(program[first])) {
+        insertQuadrupleInQueue(program[first]); /* the label, or the function marker */
+        first++;
+    }
+    if (first < last && isJump(program[last - 1])) {
+        terminator = &program[last - 1];
+        last--;
+    }
+    pass->code = &program[first];
+    pass->code_size = last - first;
+
+    intSet live = copyIntSet(block_live_out);
+    numberValues();
+    if (terminator != NULL && terminator->operand1.kind == VARIABLE_OPERAND) {
+        /* A constant condition is used directly, otherwise the condition variable
+         has to hold its value at the jump. */
+        ssaValue condition = pass->current[getPartitionSymbolIndex(terminator->operand1.value)];
+        if (condition.kind == CONSTANT_VALUE) {
+            terminator->operand1 = makeConstantOperand(condition.value);
+        }
+        else {
+            insertIntSet(terminator->operand1.value, &live);
+        }
+    }
+    if (terminator != NULL && terminator->operand1.kind == CONSTANT_OPERAND) {
+        /* The jump is then never taken, or always. */
+        if (terminator->operand1.value == 0) {
+            terminator = NULL;
+        }
+        else {
+            *terminator = makeQuadruple(terminator->lhs, GOTOOP, makeNoOperand(), makeNoOperand());
+        }
+    }
+    setLiveAtExit(live);
+
+    char *live_definitions = findLiveDefinitions();
+    leaveSSA(live_definitions);
+    free(live_definitions);
+    if (terminator != NULL) {
+        insertQuadrupleInQueue(*terminator);
+    }
+    resetBlock();
+}
+
+void runSSAOptimizations() {
+    ssaPass *pass = safeMalloc(sizeof(ssaPass));
+    int i, b;
+    compactQuadrupleQueue();
+    int size = getQuadrupleQueueSize();
+    controlFlowGraph *cfg = buildControlFlowGraph();
+    intSet program_live_at_exit = getLiveAtExit();
+    /* Strong liveness, so a block does not keep a value that only code removed in
+     another block reads. */
+    dataflowSolution liveness = computeStrongLiveness(cfg, program_live_at_exit);
+
+    /* The blocks are rebuilt into a fresh queue, so work on a copy of the program. */
+    quadruple *program = safeMalloc((size + 1) * sizeof(quadruple));
+    for (i = 0; i < size; i++) {
+        program[i] = getQuadrupleEntry(i)->quad;
+    }
+    getOptimizerContext()->ssa = pass;
+    pass->used_symbols = makeEmptyIntSet();
+    pass->temporary_count = 1;
+    for (i = 0; i < size; i++) {
+        insertIntSet(program[i].lhs, &pass->used_symbols);
+        if (program[i].operand1.kind == VARIABLE_OPERAND) {
+            insertIntSet(program[i].operand1.value, &pass->used_symbols);
+        }
+        if (program[i].operand2.kind == VARIABLE_OPERAND) {
+            insertIntSet(program[i].operand2.value, &pass->used_symbols);
+        }
+    }
+    pass->symbol_count = getPartitionSymbolCount();
+
+    pass->definition_value = safeMalloc((size + 1) * sizeof(ssaValue));
+    pass->operand1_value = safeMalloc((size + 1) * sizeof(ssaValue));
+    pass->operand2_value = safeMalloc((size + 1) * sizeof(ssaValue));
+    pass->current = safeMalloc((pass->symbol_count + 1) * sizeof(ssaValue));
+    pass->occupied_until = safeMalloc((pass->symbol_count + 1) * sizeof(int));
+    pass->exit_symbols = safeMalloc((pass->symbol_count + 1) * sizeof(symbolId));
+    pass->live_at_exit = makeEmptyIntSet();
+    for (i = 0; i < pass->symbol_count; i++) {
+        pass->current[i] = makeSSAValue(ENTRY_VALUE, getPartitionSymbols()[i]);
+        pass->occupied_until[i] = -1;
+    }
+
+    initializeQuadrupleQueue();
+    for (b = 0; b < cfg->block_count; b++) {
+        optimizeBlock(program, &cfg->blocks[b], liveness.out[b]);
+    }
+
+    freeIntSet(pass->used_symbols);
+    freeIntSet(pass->live_at_exit);
+    free(pass->exit_symbols);
+    free(pass->occupied_until);
+    free(pass->current);
+    free(pass->operand2_value);
+    free(pass->operand1_value);
+    free(pass->definition_value);
+    free(program);
+    freeDataflowSolution(liveness);
+    freeIntSet(program_live_at_exit);
+    destroyControlFlowGraph(cfg);
+    free(pass);
+    getOptimizerContext()->ssa = NULL;
+}
@@ -0,0 +1,13 @@
+#ifndef SSA_H
+#define SSA_H
+
+/* Optimizations on the static single assignment form of the quadruple queue.
+ Every definition becomes its own version of its variable, so no table has to
+ be invalidated when a variable is redefined. The pass numbers the values
+ (global value numbering, constant folding, copy propagation), removes the
+ versions that do not reach a use or the exit, and converts back by giving each
+ remaining version a name. */
+
+void runSSAOptimizations();
+
+#endif
@@ -0,0 +1,183 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "misc.h"
+#include "intset.h"
+#include "quadruple.h"
+#include "deadcode.h"
+#include "stream.h"
+
+static FILE *spill = NULL;        /* the windows of the parsed program, in order */
+static int *window_sizes = NULL;
+static int window_count = 0;
+static int window_allocated_size = 0;
+static int largest_window = 0;
+
+static FILE *createSpillFile() {
+    FILE *f = tmpfile();
+    if (f == NULL) {
+        abortMessage("Error: failed to create a spill file.");
+    }
+    return f;
+}
+
+static void readQuadruples(FILE *f, long position, quadruple *quads, int count) {
+    if (fseek(f, position * (long)sizeof(quadruple), SEEK_SET) != 0 ||
+        fread(quads, sizeof(quadruple), count, f) != (size_t)count) {
+        abortMessage("Error: failed to read back the spill file.");
+    }
+}
+
+static void writeQuadruples(FILE *f, quadruple *quads, int count) {
+    if (fwrite(quads, sizeof(quadruple), count, f) != (size_t)count) {
+        abortMessage("Error: failed to write the spill file.");
+    }
+}
+
+// Moves the quadruple queue to the spill file as the next window, and empties it.
+void spillQuadrupleQueue() {
+    int i, size = 0;
+
+    if (spill == NULL) {
+        spill = createSpillFile();
+    }
+    if (window_count == window_allocated_size) {
+        window_allocated_size = (window_allocated_size == 0 ? 64 : 2 * window_allocated_size);
+        window_sizes = safeRealloc(window_sizes, window_allocated_size * sizeof(int));
+    }
+
+    for (i = 0; i < getQuadrupleQueueSize(); i++) {
+        quadrupleEntry *entry = getQuadrupleEntry(i);
+        if (!entry->removed_quadruple) {
+            writeQuadruples(spill, &entry->quad, 1);
+            size++;
+        }
+    }
+    window_sizes[window_count++] = size;
+    if (size > largest_window) {
+        largest_window = size;
+    }
+    initializeQuadrupleQueue();
+}
+
+/* The variables that may be live at a label: all but the compiler temporaries,
+ which are never read after a label. Only the code below a jump is seen when it is
+ reached, so its target is assumed to need all of them. */
+static intSet makeLabelLiveSet() {
+    intSet live = makeEmptyIntSet();
+    int var;
+    for (var = 0; var < getSymbolCount(); var++) {
+        if (!isTemporarySymbol(var)) {
+            insertIntSet(var, &live);
+        }
+    }
+    return live;
+}
+
+/* One step of the backward sweep: returns whether quad is kept, and updates live.
+ Above a function marker is the end of the previous function. The next function
+ runs on the same variables, so there, as at a label, all of them may be read;
+ only the end of the program has the -live= set. */
+static int keepQuadruple(quadruple quad, intSet *live, intSet label_live) {
+    switch (quad.operation) {
+        case LABELOP:
+            return 1;
+        case FUNCTIONOP:
+            freeIntSet(*live);
+            *live = copyIntSet(label_live);
+            return 1;
+        case GOTOOP:
+            freeIntSet(*live);
+            *live = copyIntSet(label_live);
+            return 1;
+        case IFGOTOOP:
+            unionIntSet(live, label_live);
+            break;
+        default:
+            if (!isMemberIntSet(quad.lhs, *live)) {
+                return 0;
+            }
+            deleteIntSet(quad.lhs, live);
+            break;
+    }
+    if (quad.operand1.kind == VARIABLE_OPERAND) {
+        insertIntSet(quad.operand1.value, live);
+    }
+    if (quad.operand2.kind == VARIABLE_OPERAND) {
+        insertIntSet(quad.operand2.value, live);
+    }
+    return 1;
+}
+
+/* Spills what is left in the queue, removes the dead code window by window from
+ the end, and prints the remaining quadruples to f. The surviving quadruples go to
+ a second spill file, last window first, so printing reads that file backwards.
+ Returns the number of quadruples removed. */
+long runStreamingDeadCodeElimination(FILE *f) {
+    if (getQuadrupleQueueSize() > 0 || window_count == 0) {
+        spillQuadrupleQueue();
+    }
+
+    FILE *kept = createSpillFile();
+    int *kept_sizes = safeMalloc(window_count * sizeof(int));
+    quadruple *window = safeMalloc((largest_window + 1) * sizeof(quadruple));
+    char *keep = safeMalloc((largest_window + 1) * sizeof(char));
+    intSet live = getLiveAtExit();
+    intSet label_live = makeLabelLiveSet();
+    long position = 0, removed = 0;
+    int w, i;
+
+    for (w = 0; w < window_count; w++) {
+        position += window_sizes[w];
+    }
+    for (w = window_count - 1; w >= 0; w--) {
+        int size = window_sizes[w];
+        position -= size;
+        readQuadruples(spill, position, window, size);
+        for (i = size - 1; i >= 0; i--) {
+            keep[i] = keepQuadruple(window[i], &live, label_live);
+            removed += !keep[i];
+        }
+        fseek(kept, 0L, SEEK_END);
+        kept_sizes[w] = 0;
+        for (i = 0; i < size; i++) {
+            if (keep[i]) {
+                writeQuadruples(kept, &window[i], 1);
+                kept_sizes[w]++;
+            }
+        }
+    }
+
+    long kept_total = 0;
+    for (w = 0; w < window_count; w++) {
+        kept_total += kept_sizes[w];
+    }
+    for (w = 0; w < window_count; w++) {
+        kept_total -= kept_sizes[w];
+        readQuadruples(kept, kept_total, window, kept_sizes[w]);
+        for (i = 0; i < kept_sizes[w]; i++) {
+            fprintfQuadruple(f, window[i]);
+            fprintf(f, "\n");
+        }
+    }
+
+    freeIntSet(label_live);
+    freeIntSet(live);
+    free(keep);
+    free(window);
+    free(kept_sizes);
+    fclose(kept);
+
+    return removed;
+}
+
+void destroyStream() {
+    if (spill != NULL) {
+        fclose(spill);
+    }
+    free(window_sizes);
+    spill = NULL;
+    window_sizes = NULL;
+    window_count = 0;
+    window_allocated_size = 0;
+    largest_window = 0;
+}
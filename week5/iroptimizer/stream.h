@@ -0,0 +1,19 @@
+#ifndef STREAM_H
+#define STREAM_H
+
+#include <stdio.h>
+
+/* Streaming mode for programs that do not fit in memory. The forward passes run
+ while parsing as usual, but every full window of quadruples is spilled to a
+ temporary file. Dead code elimination then reads the windows back from last to
+ first, carrying the live variables across the window boundaries, and the result
+ is printed one window at a time. Only one window and the symbol table are ever in
+ memory. */
+
+#define DEFAULT_STREAM_WINDOW 65536
+
+void spillQuadrupleQueue();
+long runStreamingDeadCodeElimination(FILE *f);
+void destroyStream();
+
+#endif
@@ -0,0 +1,207 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "misc.h"
+#include "subexpression.h"
+#include "context.h"
+
+#define NO_HOLDER ((symbolId)-1)
+
+static unsigned int hashNode(operator operation, constantValue operand1, constantValue operand2) {
+    unsigned int hash = operation;
+    hash = hash * 0x9E3779B1u + (unsigned int)(operand1 ^ (operand1 >> 32));
+    hash = hash * 0x9E3779B1u + (unsigned int)(operand2 ^ (operand2 >> 32));
+    return hash ^ (hash >> 16);
+}
+
+static void resizeBuckets(availableExpressionTable *table) {
+    unsigned int i, mask;
+    int n;
+
+    free(table->buckets);
+    free(table->bucket_epochs);
+    table->bucket_count = (table->bucket_count == 0 ? 256 : 2 * table->bucket_count);
+    table->buckets = safeMalloc(table->bucket_count * sizeof(int));
+    table->bucket_epochs = safeMalloc(table->bucket_count * sizeof(int));
+    for (i = 0; i < table->bucket_count; i++) {
+        table->bucket_epochs[i] = -1;
+    }
+    mask = table->bucket_count - 1;
+    for (n = 0; n < table->node_count; n++) {
+        valueNode *node = &table->nodes[n];
+        i = hashNode(node->operation, node->operand1, node->operand2) & mask;
+        while (table->bucket_epochs[i] == table->epoch) {
+            i = (i + 1) & mask;
+        }
+        table->buckets[i] = n;
+        table->bucket_epochs[i] = table->epoch;
+    }
+}
+
+/* Returns the value number of the node, which is created if it is new and create
+ is set; -1 otherwise. */
+static int findNode(availableExpressionTable *table, operator operation, constantValue operand1, constantValue operand2,
+                    int create) {
+    if (2 * (table->node_count + 1) > (int)table->bucket_count) {
+        resizeBuckets(table);
+    }
+
+    unsigned int mask = table->bucket_count - 1;
+    unsigned int i = hashNode(operation, operand1, operand2) & mask;
+    while (table->bucket_epochs[i] == table->epoch) {
+        valueNode *node = &table->nodes[table->buckets[i]];
+        if (node->operation == operation && node->operand1 == operand1 && node->operand2 == operand2) {
+            return table->buckets[i];
+        }
+        i = (i + 1) & mask;
+    }
+    if (!create) {
+        return -1;
+    }
+
+    if (table->node_count == table->nodes_allocated_size) {
+        table->nodes_allocated_size = (table->nodes_allocated_size == 0 ? 256 : 2 * table->nodes_allocated_size);
+        table->nodes = safeRealloc(table->nodes, table->nodes_allocated_size * sizeof(valueNode));
+    }
+    valueNode *node = &table->nodes[table->node_count];
+    node->operation = operation;
+    node->operand1 = operand1;
+    node->operand2 = operand2;
+    node->holder = NO_HOLDER;
+    table->buckets[i] = table->node_count;
+    table->bucket_epochs[i] = table->epoch;
+    return table->node_count++;
+}
+
+// The value number var holds, -1 if it has none yet.
+static int variableValue(availableExpressionTable *table, symbolId var) {
+    int index = findSymbolIndex(&table->variables, var);
+    if (index == -1 || table->value_epochs[index] != table->epoch) {
+        return -1;
+    }
+    return table->value_numbers[index];
+}
+
+static void setVariableValue(availableExpressionTable *table, symbolId var, int value) {
+    int index = insertSymbolIndex(&table->variables, var);
+    if (index >= table->values_size) {
+        int new_size = (table->values_size == 0 ? 16 : 2 * table->values_size);
+        int i;
+        table->value_numbers = safeRealloc(table->value_numbers, new_size * sizeof(int));
+        table->value_epochs = safeRealloc(table->value_epochs, new_size * sizeof(int));
+        for (i = table->values_size; i < new_size; i++) {
+            table->value_epochs[i] = -1;
+        }
+        table->values_size = new_size;
+    }
+    table->value_numbers[index] = value;
+    table->value_epochs[index] = table->epoch;
+}
+
+/* The value number of an operand. A variable that was not assigned since the last
+ clear holds a leaf of its own. */
+static int operandValue(availableExpressionTable *table, operand op) {
+    int value = (op.kind == VARIABLE_OPERAND ? variableValue(table, op.value) : -1);
+    if (value == -1) {
+        value = findNode(table, ASSIGNMENT, op.kind, op.value, 1);
+        if (op.kind == VARIABLE_OPERAND) {
+            setVariableValue(table, op.value, value);
+            table->nodes[value].holder = op.value;
+        }
+    }
+    return value;
+}
+
+// + and * are commutative, so their operands are numbered smallest first.
+static int expressionValue(availableExpressionTable *table, quadruple quad, int create) {
+    int value1 = operandValue(table, quad.operand1);
+    int value2 = operandValue(table, quad.operand2);
+    if ((quad.operation == PLUSOP || quad.operation == TIMESOP) && value1 > value2) {
+        int tmp = value1;
+        value1 = value2;
+        value2 = tmp;
+    }
+    return findNode(table, quad.operation, value1, value2, create);
+}
+
+static int holdsValue(availableExpressionTable *table, int value) {
+    symbolId holder = table->nodes[value].holder;
+    return holder != NO_HOLDER && variableValue(table, holder) == value;
+}
+
+void initializeAvailableExpressions() {
+    destroyAvailableExpressions();
+}
+
+// Returns 1 and sets *holder to a variable that holds the value of quad if there is one.
+int lookupAvailableExpression(quadruple quad, symbolId *holder) {
+    availableExpressionTable *table = &getOptimizerContext()->expressions;
+    int value = expressionValue(table, quad, 0);
+    if (value == -1 || !holdsValue(table, value)) {
+        return 0;
+    }
+    *holder = table->nodes[value].holder;
+    return 1;
+}
+
+/* Holds the value of quad in a new temporary _n, and returns the temporary. The
+ name is one the program does not use. */
+symbolId insertAvailableExpression(quadruple quad) {
+    availableExpressionTable *table = &getOptimizerContext()->expressions;
+    int value = expressionValue(table, quad, 1);
+    symbolId temp = internTemporarySymbol(&table->temp_variable_count);
+    setVariableValue(table, temp, value);
+    table->nodes[value].holder = temp;
+    return temp;
+}
+
+/* quad.lhs is being assigned: it now holds the value quad computes, and it becomes
+ the holder of that value if nothing else holds it. */
+void assignValueNumber(quadruple quad) {
+    availableExpressionTable *table = &getOptimizerContext()->expressions;
+    int value = (quad.operation == ASSIGNMENT ? operandValue(table, quad.operand1) : expressionValue(table, quad, 1));
+    setVariableValue(table, quad.lhs, value);
+    if (table->nodes[value].holder == NO_HOLDER || !holdsValue(table, value)) {
+        table->nodes[value].holder = quad.lhs;
+    }
+}
+
+int getValueNodeCount() {
+    return getOptimizerContext()->expressions.node_count;
+}
+
+/* Forget every value, e.g. at a label where other paths join. The temporaries
+ keep their numbers, so a later expression never reuses the name of an earlier one. */
+void clearAvailableExpressions() {
+    availableExpressionTable *table = &getOptimizerContext()->expressions;
+    table->node_count = 0;
+    table->epoch++;
+}
+
+/* Number the next temporaries from _1 again. Only allowed when no code that is
+ still to come can read an earlier temporary: the tables are clear and everything
+ before has been written out, as between two windows of a streamed program. */
+void restartTemporaries() {
+    availableExpressionTable *table = &getOptimizerContext()->expressions;
+    table->temp_variable_count = 1;
+}
+
+void destroyAvailableExpressions() {
+    availableExpressionTable *table = &getOptimizerContext()->expressions;
+    free(table->nodes);
+    free(table->buckets);
+    free(table->bucket_epochs);
+    free(table->value_numbers);
+    free(table->value_epochs);
+    destroySymbolMap(&table->variables);
+    table->nodes = NULL;
+    table->node_count = 0;
+    table->nodes_allocated_size = 0;
+    table->buckets = NULL;
+    table->bucket_epochs = NULL;
+    table->bucket_count = 0;
+    table->value_numbers = NULL;
+    table->value_epochs = NULL;
+    table->values_size = 0;
+    table->epoch = 0;
+    table->temp_variable_count = 1;
+}
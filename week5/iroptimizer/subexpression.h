@@ -0,0 +1,52 @@
+#ifndef SUBEXPRESSION_H
+#define SUBEXPRESSION_H
+
+#include "quadruple.h"
+#include "symbolmap.h"
+
+/* Value numbering for common subexpression elimination. Every value is a node of
+ a hash-consed DAG: a leaf for a constant or for the value a variable has where
+ the table was last cleared, or an operator applied to two value numbers, with
+ the operands of + and * in canonical order. Every variable maps to the value
+ number it holds, so x = a and later y = x + 1 find the node of a + 1 even after
+ a is redefined, and b * a finds a * b.
+
+ A node remembers a variable that held it, normally the compiler temporary _n
+ that computes it. The holder only counts while it still maps to the node, so a
+ redefinition needs no search: nothing has to be killed. */
+
+typedef struct valueNode {
+    operator operation;         /* ASSIGNMENT for a leaf */
+    constantValue operand1, operand2;   /* value numbers; the operand kind and value of a leaf */
+    symbolId holder;
+} valueNode;
+
+/* The table of one optimizer context (see context.h). */
+typedef struct availableExpressionTable {
+    valueNode *nodes;           /* indexed by value number */
+    int node_count;
+    int nodes_allocated_size;
+
+    int *buckets;               /* open addressing, a value number per bucket */
+    int *bucket_epochs;         /* a bucket is empty unless stamped with the epoch */
+    unsigned int bucket_count;
+
+    symbolMap variables;        /* numbers the variables that were assigned a value */
+    int *value_numbers;         /* indexed by the number of the variable */
+    int *value_epochs;
+    int values_size;
+
+    int epoch;
+    int temp_variable_count;
+} availableExpressionTable;
+
+void initializeAvailableExpressions();
+int lookupAvailableExpression(quadruple quad, symbolId *holder);
+symbolId insertAvailableExpression(quadruple quad);
+void assignValueNumber(quadruple quad);
+int getValueNodeCount();
+void clearAvailableExpressions();
+void restartTemporaries();
+void destroyAvailableExpressions();
+
+#endif
@@ -0,0 +1,74 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "misc.h"
+#include "symbolmap.h"
+
+static unsigned int hashSymbol(symbolId s) {
+    unsigned int hash = s * 0x9E3779B1u;
+    return hash ^ (hash >> 16);
+}
+
+// Returns the bucket that holds s, or the free bucket it would go in.
+static unsigned int findBucket(symbolMap *map, symbolId s) {
+    unsigned int bucket = hashSymbol(s) & (map->bucket_count - 1);
+    while (map->buckets[bucket] != -1 && map->symbols[map->buckets[bucket]] != s) {
+        bucket = (bucket + 1) & (map->bucket_count - 1);
+    }
+    return bucket;
+}
+
+static void resizeBuckets(symbolMap *map) {
+    unsigned int i;
+    free(map->buckets);
+    map->bucket_count = (map->bucket_count == 0 ? 16 : 2 * map->bucket_count);
+    map->buckets = safeMalloc(map->bucket_count * sizeof(int));
+    for (i = 0; i < map->bucket_count; i++) {
+        map->buckets[i] = -1;
+    }
+    for (i = 0; i < (unsigned int)map->size; i++) {
+        map->buckets[findBucket(map, map->symbols[i])] = i;
+    }
+}
+
+void initializeSymbolMap(symbolMap *map) {
+    map->symbols = NULL;
+    map->size = 0;
+    map->allocated_size = 0;
+    map->buckets = NULL;
+    map->bucket_count = 0;
+}
+
+// The index of s, or -1 if s is not in the map.
+int findSymbolIndex(symbolMap *map, symbolId s) {
+    if (map->size == 0) {
+        return -1;
+    }
+    return map->buckets[findBucket(map, s)];
+}
+
+// The index of s; a symbol that is not in the map yet gets the next one.
+int insertSymbolIndex(symbolMap *map, symbolId s) {
+    unsigned int bucket;
+
+    /* Keep the load factor at most one half. */
+    if (2 * (map->size + 1) > (int)map->bucket_count) {
+        resizeBuckets(map);
+    }
+    bucket = findBucket(map, s);
+    if (map->buckets[bucket] != -1) {
+        return map->buckets[bucket];
+    }
+    if (map->size == map->allocated_size) {
+        map->allocated_size = (map->allocated_size == 0 ? 16 : 2 * map->allocated_size);
+        map->symbols = safeRealloc(map->symbols, map->allocated_size * sizeof(symbolId));
+    }
+    map->symbols[map->size] = s;
+    map->buckets[bucket] = map->size;
+    return map->size++;
+}
+
+void destroySymbolMap(symbolMap *map) {
+    free(map->symbols);
+    free(map->buckets);
+    initializeSymbolMap(map);
+}
@@ -0,0 +1,24 @@
+#ifndef SYMBOLMAP_H
+#define SYMBOLMAP_H
+
+#include "symtab.h"
+
+/* Numbers the symbols one partition uses 0, 1, 2, ... in the order they are added,
+ so that a per-partition table can be an array the size of the partition instead
+ of one indexed by symbol id, which would grow with the whole program. The map is
+ a hash table with open addressing from symbol id to index. */
+
+typedef struct symbolMap {
+    symbolId *symbols;          /* indexed by index */
+    int size;
+    int allocated_size;
+    int *buckets;               /* an index per bucket, -1 if the bucket is free */
+    unsigned int bucket_count;
+} symbolMap;
+
+void initializeSymbolMap(symbolMap *map);
+int findSymbolIndex(symbolMap *map, symbolId s);
+int insertSymbolIndex(symbolMap *map, symbolId s);
+void destroySymbolMap(symbolMap *map);
+
+#endif
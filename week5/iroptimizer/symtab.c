@@ -0,0 +1,238 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "misc.h"
+#include "symtab.h"
+
+#define NO_SYMBOL 0xFFFFFFFFu
+
+#define VARIABLE_SYMBOL 0
+#define LABEL_SYMBOL 1       /* a label or function name */
+#define TEMPORARY_SYMBOL 2   /* a variable a pass created */
+#define RENAMED_TEMPORARY_SYMBOL 3
+
+static char **symbol_names = NULL; /* indexed by symbol id */
+static char *symbol_kinds = NULL;  /* indexed by symbol id */
+static int symbol_count = 0;
+static int symbol_names_allocated_size = 0;
+static int renamed_temporary_number = 1;
+
+static symbolId *buckets = NULL;     /* open addressing, NO_SYMBOL marks a free bucket */
+static unsigned int bucket_count = 0;
+
+/* Partitions are optimized in parallel and may intern names at the same time. */
+static pthread_mutex_t symbol_table_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static unsigned int hashName(const char *name, int length) {
+    /* FNV-1a */
+    unsigned int hash = 2166136261u;
+    int i;
+    for (i = 0; i < length; i++) {
+        hash = (hash ^ (unsigned char)name[i]) * 16777619u;
+    }
+    return hash;
+}
+
+static void resizeBuckets() {
+    unsigned int i;
+    free(buckets);
+    bucket_count = (bucket_count == 0 ? 256 : 2 * bucket_count);
+    buckets = safeMalloc(bucket_count * sizeof(symbolId));
+    for (i = 0; i < bucket_count; i++) {
+        buckets[i] = NO_SYMBOL;
+    }
+    /* Rehash the names already interned. */
+    for (i = 0; i < (unsigned int)symbol_count; i++) {
+        unsigned int bucket = hashName(symbol_names[i], strlen(symbol_names[i])) & (bucket_count - 1);
+        while (buckets[bucket] != NO_SYMBOL) {
+            bucket = (bucket + 1) & (bucket_count - 1);
+        }
+        buckets[bucket] = i;
+    }
+}
+
+void initializeSymbolTable() {
+    destroySymbolTable();
+}
+
+// Returns the bucket that holds name, or the free bucket it would go in.
+static unsigned int findBucket(const char *name, int length) {
+    unsigned int bucket = hashName(name, length) & (bucket_count - 1);
+    while (buckets[bucket] != NO_SYMBOL) {
+        char *known = symbol_names[buckets[bucket]];
+        if (strncmp(known, name, length) == 0 && known[length] == '\0') {
+            break;
+        }
+        bucket = (bucket + 1) & (bucket_count - 1);
+    }
+    return bucket;
+}
+
+static char *copyName(const char *name, int length) {
+    char *copy = safeMalloc(length + 1);
+    memcpy(copy, name, length);
+    copy[length] = '\0';
+    return copy;
+}
+
+static symbolId appendSymbol(char *name, unsigned int bucket) {
+    if (symbol_count == symbol_names_allocated_size) {
+        symbol_names_allocated_size = (symbol_names_allocated_size == 0 ? 64 : 2 * symbol_names_allocated_size);
+        symbol_names = safeRealloc(symbol_names, symbol_names_allocated_size * sizeof(char *));
+        symbol_kinds = safeRealloc(symbol_kinds, symbol_names_allocated_size * sizeof(char));
+    }
+    symbol_names[symbol_count] = name;
+    symbol_kinds[symbol_count] = VARIABLE_SYMBOL;
+    buckets[bucket] = symbol_count;
+    return symbol_count++;
+}
+
+static symbolId internSymbolLocked(const char *name, int length) {
+    /* Room for one more symbol and for a temporary that has to be renamed. */
+    if (2 * (symbol_count + 2) > (int)bucket_count) {
+        resizeBuckets();
+    }
+
+    unsigned int bucket = findBucket(name, length);
+    if (buckets[bucket] != NO_SYMBOL) {
+        return buckets[bucket];
+    }
+    return appendSymbol(copyName(name, length), bucket);
+}
+
+/* The program uses the name of a temporary that a pass already created. The
+ temporary keeps its id under a name nothing has used yet, and the name becomes a
+ new variable; the old string goes with the name, so a pointer to it stays valid.
+ A partition may already number its temporaries past the new name, so the passes
+ are never handed a renamed temporary again. */
+static symbolId renameTemporaryLocked(symbolId temp, unsigned int bucket) {
+    char name[32];
+    unsigned int new_bucket;
+    do {
+        sprintf(name, "_%d", renamed_temporary_number++);
+        new_bucket = findBucket(name, strlen(name));
+    } while (buckets[new_bucket] != NO_SYMBOL);
+
+    symbolId variable = appendSymbol(symbol_names[temp], bucket);
+    symbol_names[temp] = copyName(name, strlen(name));
+    symbol_kinds[temp] = RENAMED_TEMPORARY_SYMBOL;
+    buckets[new_bucket] = temp;
+    return variable;
+}
+
+/* Returns the id of name, adding it to the table on its first appearance. The
+ names of the program are interned with these two functions, the temporaries of the
+ passes with internTemporarySymbol(). */
+symbolId internSymbol(char *name) {
+    return internSymbolRange(name, strlen(name));
+}
+
+/* The same for the length characters at name, which need not be followed by a
+ '\0'; the name is only copied when it is new. */
+symbolId internSymbolRange(const char *name, int length) {
+    pthread_mutex_lock(&symbol_table_lock);
+    symbolId s = internSymbolLocked(name, length);
+    if (symbol_kinds[s] == TEMPORARY_SYMBOL || symbol_kinds[s] == RENAMED_TEMPORARY_SYMBOL) {
+        s = renameTemporaryLocked(s, findBucket(name, length));
+    }
+    pthread_mutex_unlock(&symbol_table_lock);
+    return s;
+}
+
+/* The temporary _n for the first n from *next_number on that is not a name of the
+ program, and *next_number moves past it. Partitions number their temporaries on
+ their own, so they share the ids of the names they have in common. */
+symbolId internTemporarySymbol(int *next_number) {
+    char name[32];
+    symbolId s;
+
+    pthread_mutex_lock(&symbol_table_lock);
+    do {
+        int count = symbol_count;
+        sprintf(name, "_%d", (*next_number)++);
+        s = internSymbolLocked(name, strlen(name));
+        if ((int)s >= count) {
+            symbol_kinds[s] = TEMPORARY_SYMBOL;
+        }
+    } while (symbol_kinds[s] != TEMPORARY_SYMBOL);
+    pthread_mutex_unlock(&symbol_table_lock);
+    return s;
+}
+
+/* The name stays valid until destroySymbolTable(), even when the table grows; a
+ temporary may get another name while the program is read. */
+char *getSymbolName(symbolId s) {
+    pthread_mutex_lock(&symbol_table_lock);
+    if (s >= (unsigned int)symbol_count) {
+        fprintf(stderr, "Error: unknown symbol id \"%u\".\n", s);
+        exit(EXIT_FAILURE);
+    }
+    char *name = symbol_names[s];
+    pthread_mutex_unlock(&symbol_table_lock);
+    return name;
+}
+
+/* Labels and function names share the table with the variables; the parser marks
+ them, so a pass can tell them apart without seeing the quadruple that names them. */
+void markLabelSymbol(symbolId s) {
+    pthread_mutex_lock(&symbol_table_lock);
+    symbol_kinds[s] = LABEL_SYMBOL;
+    pthread_mutex_unlock(&symbol_table_lock);
+}
+
+int isLabelSymbol(symbolId s) {
+    pthread_mutex_lock(&symbol_table_lock);
+    int is_label = (symbol_kinds[s] == LABEL_SYMBOL);
+    pthread_mutex_unlock(&symbol_table_lock);
+    return is_label;
+}
+
+// Whether a pass created the symbol with internTemporarySymbol().
+int isTemporarySymbol(symbolId s) {
+    pthread_mutex_lock(&symbol_table_lock);
+    int is_temporary = (symbol_kinds[s] == TEMPORARY_SYMBOL || symbol_kinds[s] == RENAMED_TEMPORARY_SYMBOL);
+    pthread_mutex_unlock(&symbol_table_lock);
+    return is_temporary;
+}
+
+/* isTemporarySymbol() and isLabelSymbol() for count symbols at once, under one
+ lock; either result array may be NULL. */
+void classifySymbols(const symbolId *symbols, int count, char *is_temporary, char *is_label) {
+    int i;
+    pthread_mutex_lock(&symbol_table_lock);
+    for (i = 0; i < count; i++) {
+        char kind = symbol_kinds[symbols[i]];
+        if (is_temporary != NULL) {
+            is_temporary[i] = (kind == TEMPORARY_SYMBOL || kind == RENAMED_TEMPORARY_SYMBOL);
+        }
+        if (is_label != NULL) {
+            is_label[i] = (kind == LABEL_SYMBOL);
+        }
+    }
+    pthread_mutex_unlock(&symbol_table_lock);
+}
+
+int getSymbolCount() {
+    pthread_mutex_lock(&symbol_table_lock);
+    int count = symbol_count;
+    pthread_mutex_unlock(&symbol_table_lock);
+    return count;
+}
+
+void destroySymbolTable() {
+    int i;
+    for (i = 0; i < symbol_count; i++) {
+        free(symbol_names[i]);
+    }
+    free(symbol_names);
+    free(symbol_kinds);
+    free(buckets);
+    symbol_names = NULL;
+    symbol_kinds = NULL;
+    symbol_count = 0;
+    renamed_temporary_number = 1;
+    symbol_names_allocated_size = 0;
+    buckets = NULL;
+    bucket_count = 0;
+}
@@ -0,0 +1,21 @@
+#ifndef SYMTAB_H
+#define SYMTAB_H
+
+/* Interned variable names. Every distinct name is stored once and identified by a
+ dense 32-bit id (0, 1, 2, ... in order of first appearance), so names compare as
+ integers. The table is shared by all threads. */
+typedef unsigned int symbolId;
+
+void initializeSymbolTable();
+symbolId internSymbol(char *name);
+symbolId internSymbolRange(const char *name, int length);
+char *getSymbolName(symbolId s);
+void markLabelSymbol(symbolId s);
+int isLabelSymbol(symbolId s);
+symbolId internTemporarySymbol(int *next_number);
+int isTemporarySymbol(symbolId s);
+void classifySymbols(const symbolId *symbols, int count, char *is_temporary, char *is_label);
+int getSymbolCount();
+void destroySymbolTable();
+
+#endif